@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Solves the rectangular assignment problem with the Hungarian algorithm, in O(rows^2 * columns)
+// costs holds the cost of assigning row r to column c at r * columns + c, and rows must not exceed columns
+// Returns the column assigned to each row, such that no column is used twice and the total cost is minimal
+std::vector<std::size_t> solveAssignment(const std::vector<double> &costs, std::size_t rows, std::size_t columns) {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Rows and columns are 1-indexed below, column 0 is a virtual column holding the row that is being added
+    std::vector<double> rowPotentials(rows + 1);
+    std::vector<double> columnPotentials(columns + 1);
+    std::vector<std::size_t> columnRows(columns + 1);
+    std::vector<std::size_t> previousColumns(columns + 1);
+
+    std::vector<double> minSlack(columns + 1);
+    std::vector<char> used(columns + 1);
+
+    for (std::size_t row = 1; row <= rows; row++) {
+        columnRows[0] = row;
+
+        std::size_t column = 0;
+        std::fill(minSlack.begin(), minSlack.end(), INF);
+        std::fill(used.begin(), used.end(), 0);
+
+        // Grow a tree of tight edges from the new row until it reaches a free column
+        do {
+            used[column] = 1;
+
+            std::size_t currentRow = columnRows[column];
+            const double *rowCosts = costs.data() + (currentRow - 1) * columns;
+
+            double delta = INF;
+            std::size_t nextColumn = 0;
+
+            for (std::size_t c = 1; c <= columns; c++) {
+                if (used[c]) {
+                    continue;
+                }
+
+                double slack = rowCosts[c - 1] - rowPotentials[currentRow] - columnPotentials[c];
+                if (slack < minSlack[c]) {
+                    minSlack[c] = slack;
+                    previousColumns[c] = column;
+                }
+
+                if (minSlack[c] < delta) {
+                    delta = minSlack[c];
+                    nextColumn = c;
+                }
+            }
+
+            for (std::size_t c = 0; c <= columns; c++) {
+                if (used[c]) {
+                    rowPotentials[columnRows[c]] += delta;
+                    columnPotentials[c] -= delta;
+                } else {
+                    minSlack[c] -= delta;
+                }
+            }
+
+            column = nextColumn;
+        } while (columnRows[column] != 0);
+
+        // Flip the augmenting path back to the virtual column
+        do {
+            std::size_t previousColumn = previousColumns[column];
+            columnRows[column] = columnRows[previousColumn];
+            column = previousColumn;
+        } while (column != 0);
+    }
+
+    std::vector<std::size_t> assignment(rows);
+    for (std::size_t c = 1; c <= columns; c++) {
+        if (columnRows[c] != 0) {
+            assignment[columnRows[c] - 1] = c - 1;
+        }
+    }
+
+    return assignment;
+}
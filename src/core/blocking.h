@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Blocking tests of lines between points and circles, which all agree bit for bit, also on lines that touch a circle
+// within rounding error, as incrementally maintained blocker counts rely on it
+// The AVX-512 or AVX2 path is selected at build time based on the target architecture, with a scalar fallback
+// -Ofast would let the compiler contract and reassociate the arithmetic differently depending on which operands are
+// loop-invariant, so this file is compiled with strict IEEE arithmetic and the functions are never inlined into code
+// that isn't, and every vector lane and the scalar test then evaluate the same correctly rounded operations
+#if defined(__clang__)
+#pragma float_control(precise, on, push)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("no-fast-math", "fp-contract=off")
+#endif
+
+// Returns whether the circle with the given center and radius blocks the line between from and to
+[[gnu::noinline]]
+bool isBlocking(double fromX,
+                double fromY,
+                double toX,
+                double toY,
+                double blockingX,
+                double blockingY,
+                double blockingRadius) {
+    // Based on https://math.stackexchange.com/a/275537
+
+    double ax = fromX - blockingX;
+    double ay = fromY - blockingY;
+
+    double bx = toX - blockingX;
+    double by = toY - blockingY;
+
+    double a = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
+    double b = 2 * (ax * (bx - ax) + ay * (by - ay));
+    double c = ax * ax + ay * ay - blockingRadius * blockingRadius;
+
+    double disc = b * b - 4 * a * c;
+    if (disc <= 0) {
+        return false;
+    }
+
+    double discSqrt = std::sqrt(disc);
+    double t1 = (-b + discSqrt) / (2 * a);
+    double t2 = (-b - discSqrt) / (2 * a);
+    return (0 < t1 && t1 < 1) || (0 < t2 && t2 < 1);
+}
+
+#if defined(__AVX512F__)
+// Returns which of the given lanes have their line from (fromXs, fromYs) to (toXs, toYs) blocked by their circle at
+// (cxs, cys), following isBlocking()
+inline __mmask8 getBlockingLanes(__m512d fromXs,
+                                 __m512d fromYs,
+                                 __m512d toXs,
+                                 __m512d toYs,
+                                 __m512d cxs,
+                                 __m512d cys,
+                                 __m512d radii2,
+                                 __mmask8 lanes) {
+    const __m512d zeros = _mm512_setzero_pd();
+    const __m512d ones = _mm512_set1_pd(1);
+    const __m512d twos = _mm512_set1_pd(2);
+    const __m512d fours = _mm512_set1_pd(4);
+
+    __m512d ax = _mm512_sub_pd(fromXs, cxs);
+    __m512d ay = _mm512_sub_pd(fromYs, cys);
+    __m512d dx = _mm512_sub_pd(_mm512_sub_pd(toXs, cxs), ax);
+    __m512d dy = _mm512_sub_pd(_mm512_sub_pd(toYs, cys), ay);
+
+    __m512d a = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+    __m512d b = _mm512_mul_pd(twos, _mm512_add_pd(_mm512_mul_pd(ax, dx), _mm512_mul_pd(ay, dy)));
+    __m512d c = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(ax, ax), _mm512_mul_pd(ay, ay)), radii2);
+
+    __m512d disc = _mm512_sub_pd(_mm512_mul_pd(b, b), _mm512_mul_pd(_mm512_mul_pd(fours, a), c));
+    lanes = _mm512_mask_cmp_pd_mask(lanes, disc, zeros, _CMP_GT_OQ);
+    if (lanes == 0) {
+        return 0;
+    }
+
+    __m512d discSqrt = _mm512_maskz_sqrt_pd(lanes, disc);
+    __m512d a2 = _mm512_mul_pd(twos, a);
+    __m512d t1 = _mm512_div_pd(_mm512_sub_pd(discSqrt, b), a2);
+    __m512d t2 = _mm512_div_pd(_mm512_sub_pd(_mm512_sub_pd(zeros, b), discSqrt), a2);
+
+    __mmask8 t1Inside = _mm512_mask_cmp_pd_mask(_mm512_cmp_pd_mask(zeros, t1, _CMP_LT_OQ), t1, ones, _CMP_LT_OQ);
+    __mmask8 t2Inside = _mm512_mask_cmp_pd_mask(_mm512_cmp_pd_mask(zeros, t2, _CMP_LT_OQ), t2, ones, _CMP_LT_OQ);
+
+    return lanes & (t1Inside | t2Inside);
+}
+
+// Returns the lanes of a batch of 8 starting at i that lie before end
+inline __mmask8 getValidLanes(std::size_t i, std::size_t end) {
+    return end - i >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << (end - i)) - 1);
+}
+#elif defined(__AVX2__)
+// Returns which of the given lanes have their line from (fromXs, fromYs) to (toXs, toYs) blocked by their circle at
+// (cxs, cys), following isBlocking()
+inline int getBlockingLanes(__m256d fromXs,
+                            __m256d fromYs,
+                            __m256d toXs,
+                            __m256d toYs,
+                            __m256d cxs,
+                            __m256d cys,
+                            __m256d radii2,
+                            int lanes) {
+    const __m256d zeros = _mm256_setzero_pd();
+    const __m256d ones = _mm256_set1_pd(1);
+    const __m256d twos = _mm256_set1_pd(2);
+    const __m256d fours = _mm256_set1_pd(4);
+
+    __m256d ax = _mm256_sub_pd(fromXs, cxs);
+    __m256d ay = _mm256_sub_pd(fromYs, cys);
+    __m256d dx = _mm256_sub_pd(_mm256_sub_pd(toXs, cxs), ax);
+    __m256d dy = _mm256_sub_pd(_mm256_sub_pd(toYs, cys), ay);
+
+    __m256d a = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    __m256d b = _mm256_mul_pd(twos, _mm256_add_pd(_mm256_mul_pd(ax, dx), _mm256_mul_pd(ay, dy)));
+    __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(ax, ax), _mm256_mul_pd(ay, ay)), radii2);
+
+    __m256d disc = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(_mm256_mul_pd(fours, a), c));
+    __m256d discPositive = _mm256_cmp_pd(disc, zeros, _CMP_GT_OQ);
+    lanes &= _mm256_movemask_pd(discPositive);
+    if (lanes == 0) {
+        return 0;
+    }
+
+    __m256d discSqrt = _mm256_sqrt_pd(_mm256_max_pd(disc, zeros));
+    __m256d a2 = _mm256_mul_pd(twos, a);
+    __m256d t1 = _mm256_div_pd(_mm256_sub_pd(discSqrt, b), a2);
+    __m256d t2 = _mm256_div_pd(_mm256_sub_pd(_mm256_sub_pd(zeros, b), discSqrt), a2);
+
+    __m256d t1Inside = _mm256_and_pd(_mm256_cmp_pd(zeros, t1, _CMP_LT_OQ), _mm256_cmp_pd(t1, ones, _CMP_LT_OQ));
+    __m256d t2Inside = _mm256_and_pd(_mm256_cmp_pd(zeros, t2, _CMP_LT_OQ), _mm256_cmp_pd(t2, ones, _CMP_LT_OQ));
+
+    return lanes & _mm256_movemask_pd(_mm256_or_pd(t1Inside, t2Inside));
+}
+
+// Returns the lanes of a batch of 4 starting at i that lie before end
+inline int getValidLanes(std::size_t i, std::size_t end) {
+    return end - i >= 4 ? 0xF : (1 << (end - i)) - 1;
+}
+
+// Loads the lanes of a batch of 4 starting at values + i that lie before values + end, and zeros the others
+inline __m256d loadValidLanes(const double *values, std::size_t i, std::size_t end) {
+    __m256i laneIndices = _mm256_set_epi64x(3, 2, 1, 0);
+    __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(end - i)), laneIndices);
+    return _mm256_maskload_pd(values + i, mask);
+}
+#endif
+
+// Tests one line against the circles with centers (xs[i], ys[i]) for all i in [begin, end) except skip, all with the
+// same radius
+// Returns the number of blocking circles, or 1 as soon as a blocking circle is found if stopAtFirst is true
+[[gnu::noinline]]
+std::size_t countBlocking(double fromX,
+                          double fromY,
+                          double toX,
+                          double toY,
+                          const double *xs,
+                          const double *ys,
+                          std::size_t begin,
+                          std::size_t end,
+                          std::size_t skip,
+                          double radius,
+                          bool stopAtFirst = false) {
+    std::size_t count = 0;
+
+#if defined(__AVX512F__)
+    const __m512d fromXs = _mm512_set1_pd(fromX);
+    const __m512d fromYs = _mm512_set1_pd(fromY);
+    const __m512d toXs = _mm512_set1_pd(toX);
+    const __m512d toYs = _mm512_set1_pd(toY);
+    const __m512d radii2 = _mm512_set1_pd(radius * radius);
+
+    for (std::size_t i = begin; i < end; i += 8) {
+        __mmask8 lanes = getValidLanes(i, end);
+        if (skip >= i && skip < i + 8) {
+            lanes &= static_cast<__mmask8>(~(1u << (skip - i)));
+        }
+
+        __m512d cxs = _mm512_maskz_loadu_pd(lanes, xs + i);
+        __m512d cys = _mm512_maskz_loadu_pd(lanes, ys + i);
+
+        lanes = getBlockingLanes(fromXs, fromYs, toXs, toYs, cxs, cys, radii2, lanes);
+        if (lanes != 0) {
+            if (stopAtFirst) {
+                return 1;
+            }
+
+            count += static_cast<std::size_t>(__builtin_popcount(lanes));
+        }
+    }
+#elif defined(__AVX2__)
+    const __m256d fromXs = _mm256_set1_pd(fromX);
+    const __m256d fromYs = _mm256_set1_pd(fromY);
+    const __m256d toXs = _mm256_set1_pd(toX);
+    const __m256d toYs = _mm256_set1_pd(toY);
+    const __m256d radii2 = _mm256_set1_pd(radius * radius);
+
+    for (std::size_t i = begin; i < end; i += 4) {
+        int lanes = getValidLanes(i, end);
+        if (skip >= i && skip < i + 4) {
+            lanes &= ~(1 << (skip - i));
+        }
+
+        __m256d cxs = loadValidLanes(xs, i, end);
+        __m256d cys = loadValidLanes(ys, i, end);
+
+        lanes = getBlockingLanes(fromXs, fromYs, toXs, toYs, cxs, cys, radii2, lanes);
+        if (lanes != 0) {
+            if (stopAtFirst) {
+                return 1;
+            }
+
+            count += static_cast<std::size_t>(__builtin_popcount(lanes));
+        }
+    }
+#else
+    for (std::size_t i = begin; i < end; i++) {
+        if (i != skip && isBlocking(fromX, fromY, toX, toY, xs[i], ys[i], radius)) {
+            if (stopAtFirst) {
+                return 1;
+            }
+
+            count++;
+        }
+    }
+#endif
+
+    return count;
+}
+
+// Tests the lines from one point to the points (toXs[i], toYs[i]) for all i in [0, count) against a circle before and
+// after it moved from (oldX, oldY) to (newX, newY), and sets deltas[i] to how the number of circles blocking line i
+// changes, -1, 0 or 1
+[[gnu::noinline]]
+void getBlockingDeltas(double fromX,
+                       double fromY,
+                       const double *toXs,
+                       const double *toYs,
+                       std::size_t count,
+                       double oldX,
+                       double oldY,
+                       double newX,
+                       double newY,
+                       double radius,
+                       int *deltas) {
+#if defined(__AVX512F__)
+    const __m512d fromXs = _mm512_set1_pd(fromX);
+    const __m512d fromYs = _mm512_set1_pd(fromY);
+    const __m512d oldXs = _mm512_set1_pd(oldX);
+    const __m512d oldYs = _mm512_set1_pd(oldY);
+    const __m512d newXs = _mm512_set1_pd(newX);
+    const __m512d newYs = _mm512_set1_pd(newY);
+    const __m512d radii2 = _mm512_set1_pd(radius * radius);
+
+    for (std::size_t i = 0; i < count; i += 8) {
+        __mmask8 lanes = getValidLanes(i, count);
+
+        __m512d lineXs = _mm512_maskz_loadu_pd(lanes, toXs + i);
+        __m512d lineYs = _mm512_maskz_loadu_pd(lanes, toYs + i);
+
+        __mmask8 wasBlocking = getBlockingLanes(fromXs, fromYs, lineXs, lineYs, oldXs, oldYs, radii2, lanes);
+        __mmask8 nowBlocking = getBlockingLanes(fromXs, fromYs, lineXs, lineYs, newXs, newYs, radii2, lanes);
+
+        for (std::size_t lane = 0; lane < 8 && i + lane < count; lane++) {
+            deltas[i + lane] = ((nowBlocking >> lane) & 1) - ((wasBlocking >> lane) & 1);
+        }
+    }
+#elif defined(__AVX2__)
+    const __m256d fromXs = _mm256_set1_pd(fromX);
+    const __m256d fromYs = _mm256_set1_pd(fromY);
+    const __m256d oldXs = _mm256_set1_pd(oldX);
+    const __m256d oldYs = _mm256_set1_pd(oldY);
+    const __m256d newXs = _mm256_set1_pd(newX);
+    const __m256d newYs = _mm256_set1_pd(newY);
+    const __m256d radii2 = _mm256_set1_pd(radius * radius);
+
+    for (std::size_t i = 0; i < count; i += 4) {
+        int lanes = getValidLanes(i, count);
+
+        __m256d lineXs = loadValidLanes(toXs, i, count);
+        __m256d lineYs = loadValidLanes(toYs, i, count);
+
+        int wasBlocking = getBlockingLanes(fromXs, fromYs, lineXs, lineYs, oldXs, oldYs, radii2, lanes);
+        int nowBlocking = getBlockingLanes(fromXs, fromYs, lineXs, lineYs, newXs, newYs, radii2, lanes);
+
+        for (std::size_t lane = 0; lane < 4 && i + lane < count; lane++) {
+            deltas[i + lane] = ((nowBlocking >> lane) & 1) - ((wasBlocking >> lane) & 1);
+        }
+    }
+#else
+    for (std::size_t i = 0; i < count; i++) {
+        deltas[i] = static_cast<int>(isBlocking(fromX, fromY, toXs[i], toYs[i], newX, newY, radius))
+                    - static_cast<int>(isBlocking(fromX, fromY, toXs[i], toYs[i], oldX, oldY, radius));
+    }
+#endif
+}
+
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/generators.h>
+#include <core/models.h>
+
+// Returns valid candidate points for musicians: the points along the edges of the stage that generateRandomSolution()
+// starts with, followed by a hexagonal grid, which is the densest packing of points 10 apart, covering the rest of
+// the stage
+// If the stage is too small, there may be fewer candidate points than musicians
+std::vector<Point> generateCandidatePoints(const Problem &problem) {
+    PlacementGrid grid(problem.stage);
+
+    addEdgePoints(grid, problem.stage);
+    addHexagonalGridPoints(grid, problem.stage);
+
+    return grid.getPlacements();
+}
+
+// Returns the value of every (instrument, point) pair at points[p] as values[instrument * points.size() + p]
+// The value is the impact of a musician playing the instrument at the point on all attendees that see it, where the
+// view is blocked by pillars, and also by musicians at all other points if musiciansBlock is true
+std::vector<double> getPointValues(const Problem &problem, const std::vector<Point> &points, bool musiciansBlock) {
+    std::size_t pointCount = points.size();
+    std::size_t attendeeCount = problem.attendees.size();
+    std::size_t instrumentCount = problem.instrumentCount;
+
+    oneapi::tbb::combinable<std::vector<double>> localValues([&] {
+        return std::vector<double>(instrumentCount * pointCount);
+    });
+
+    oneapi::tbb::parallel_for(
+            oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+            [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                auto &values = localValues.local();
+
+                VisibilitySweep sweep;
+                for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                    Point position(problem.attendeeXs[attendeeIdx], problem.attendeeYs[attendeeIdx]);
+                    const double *tastes = problem.getAttendeeTastes(attendeeIdx);
+
+                    if (musiciansBlock) {
+                        sweep.reset(position, points, &problem.pillars, &problem.pillarOcclusions[attendeeIdx]);
+                    }
+
+                    for (std::size_t p = 0; p < pointCount; p++) {
+                        bool blocked = musiciansBlock
+                                       ? sweep.isBlocked(p)
+                                       : problem.isPillarBlocked(attendeeIdx, points[p]);
+                        if (blocked) {
+                            continue;
+                        }
+
+                        double distance = position.distanceTo2(points[p]);
+                        for (std::size_t instrument = 0; instrument < instrumentCount; instrument++) {
+                            double taste = 1'000'000.0 * tastes[instrument];
+                            values[instrument * pointCount + p] += std::ceil(taste / distance);
+                        }
+                    }
+                }
+            }
+    );
+
+    std::vector<double> values(instrumentCount * pointCount);
+    localValues.combine_each([&](const std::vector<double> &local) {
+        for (std::size_t i = 0; i < local.size(); i++) {
+            values[i] += local[i];
+        }
+    });
+
+    return values;
+}
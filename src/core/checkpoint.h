@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <core/files.h>
+
+// Compact binary snapshots of solver state, so interrupted runs can be resumed
+// A snapshot is a magic number and a format version followed by the fields in the order they were written, in the
+// native byte order, as snapshots are only read back on the machine type they were written on
+constexpr std::uint32_t CHECKPOINT_MAGIC = 0x4b435043;
+constexpr std::uint32_t CHECKPOINT_VERSION = 1;
+
+class CheckpointWriter {
+    std::string buffer;
+
+public:
+    CheckpointWriter() {
+        write(CHECKPOINT_MAGIC);
+        write(CHECKPOINT_VERSION);
+    }
+
+    template<typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void write(const std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(static_cast<std::uint64_t>(values.size()));
+        buffer.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+
+    void write(const std::string &value) {
+        write(static_cast<std::uint64_t>(value.size()));
+        buffer.append(value);
+    }
+
+    // Standard random engines only expose their state through their textual representation
+    template<typename Rng>
+    void writeRng(const Rng &rng) {
+        std::ostringstream stream;
+        stream << rng;
+        write(stream.str());
+    }
+
+    // Writes the snapshot atomically, so that path always holds a complete snapshot even if the process is killed while
+    // writing
+    bool save(const std::filesystem::path &path) const {
+        return writeFileAtomically(path, buffer);
+    }
+};
+
+// Reads back a snapshot written by CheckpointWriter, reading past its end or a mismatching format makes it invalid
+class CheckpointReader {
+    std::string buffer;
+    std::size_t offset = 0;
+    bool valid = true;
+
+    explicit CheckpointReader(std::string buffer) : buffer(std::move(buffer)) {}
+
+public:
+    // Returns nothing if the file doesn't exist or wasn't written by a compatible CheckpointWriter
+    static std::optional<CheckpointReader> load(const std::filesystem::path &path) {
+        std::ifstream inputStream(path, std::ios::binary);
+        if (!inputStream) {
+            return std::nullopt;
+        }
+
+        CheckpointReader reader(std::string(std::istreambuf_iterator<char>(inputStream), {}));
+
+        auto magic = reader.read<std::uint32_t>();
+        auto version = reader.read<std::uint32_t>();
+        if (!reader.isValid() || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+            return std::nullopt;
+        }
+
+        return reader;
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    template<typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T value{};
+        if (!consume(sizeof(T))) {
+            return value;
+        }
+
+        std::memcpy(&value, buffer.data() + offset - sizeof(T), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> readVector() {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        auto size = read<std::uint64_t>();
+        if (!valid || size > (buffer.size() - offset) / sizeof(T)) {
+            valid = false;
+            return {};
+        }
+
+        std::vector<T> values(size);
+        if (consume(size * sizeof(T)) && size > 0) {
+            std::memcpy(values.data(), buffer.data() + offset - size * sizeof(T), size * sizeof(T));
+        }
+
+        return values;
+    }
+
+    std::string readString() {
+        auto size = read<std::uint64_t>();
+        if (!valid || !consume(size)) {
+            return {};
+        }
+
+        return buffer.substr(offset - size, size);
+    }
+
+    template<typename Rng>
+    void readRng(Rng &rng) {
+        std::istringstream stream(readString());
+        if (!(stream >> rng)) {
+            valid = false;
+        }
+    }
+
+private:
+    bool consume(std::size_t size) {
+        if (!valid || size > buffer.size() - offset) {
+            valid = false;
+            return false;
+        }
+
+        offset += size;
+        return true;
+    }
+};
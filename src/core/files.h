@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Returns a name for a temporary file or directory next to path that no other call, thread or process uses
+std::filesystem::path getTemporaryPath(const std::filesystem::path &path) {
+    static std::atomic<std::uint64_t> counter{0};
+
+    auto temporaryPath = path;
+    temporaryPath += "." + std::to_string(getpid()) + "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+    return temporaryPath;
+}
+
+// Flushes the entries of the directory to disk, so renames into it survive a crash
+bool syncDirectory(const std::filesystem::path &directory) {
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+// Writes data to a new file at path and flushes it to disk, fails if the file already exists
+bool writeNewFile(const std::filesystem::path &path, std::string_view data) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char *position = data.data();
+    std::size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, position, remaining);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (written <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        position += written;
+        remaining -= static_cast<std::size_t>(written);
+    }
+
+    bool synced = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+}
+
+// Writes data to a temporary file next to path and renames it to path, so that readers of path only ever see the
+// previous or the new contents, even if the process is killed or the machine crashes while writing
+// The contents are flushed to disk before the rename and the directory after it, otherwise a crash could leave an empty
+// file behind the new name
+bool writeFileAtomically(const std::filesystem::path &path, std::string_view data) {
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    auto temporaryPath = getTemporaryPath(path);
+    if (!writeNewFile(temporaryPath, data)) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    return syncDirectory(path.parent_path());
+}
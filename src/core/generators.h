@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <core/models.h>
+
+// Adds the points 10 apart along the edges of the stage that fit in the grid, the edges are closest to the attendees
+void addEdgePoints(PlacementGrid &grid, const Area &stage) {
+    auto addIfValid = [&](const Point &point) {
+        if (grid.canAdd(point)) {
+            grid.add(point);
+        }
+    };
+
+    for (double x = stage.bottomLeft.x; x <= stage.bottomLeft.x + stage.width; x += 10) {
+        addIfValid({x, stage.bottomLeft.y});
+    }
+
+    for (double x = stage.bottomLeft.x; x <= stage.bottomLeft.x + stage.width; x += 10) {
+        addIfValid({x, stage.bottomLeft.y + stage.height});
+    }
+
+    for (double y = stage.bottomLeft.y; y <= stage.bottomLeft.y + stage.height; y += 10) {
+        addIfValid({stage.bottomLeft.x, y});
+    }
+
+    for (double y = stage.bottomLeft.y; y <= stage.bottomLeft.y + stage.height; y += 10) {
+        addIfValid({stage.bottomLeft.x + stage.width, y});
+    }
+}
+
+// Adds the points of a hexagonal grid covering the stage that fit in the grid
+// A hexagonal grid is the densest packing of points 10 apart
+void addHexagonalGridPoints(PlacementGrid &grid, const Area &stage) {
+    // Slightly more than the minimum distance, so rounding errors never make neighbouring grid points too close
+    constexpr double SPACING = 10 + 1e-6;
+
+    double rowHeight = SPACING * std::sqrt(3.0) / 2;
+    for (std::size_t row = 0; static_cast<double>(row) * rowHeight <= stage.height; row++) {
+        double y = stage.bottomLeft.y + static_cast<double>(row) * rowHeight;
+        double offset = row % 2 == 0 ? 0 : SPACING / 2;
+
+        for (double x = stage.bottomLeft.x + offset; x <= stage.bottomLeft.x + stage.width; x += SPACING) {
+            if (grid.canAdd({x, y})) {
+                grid.add({x, y});
+            }
+        }
+    }
+}
+
+// Places musicians on the edges of the stage first, and fills the rest of the stage with Poisson-disk sampling
+// (Bridson's algorithm) once the edges are full, in a random order
+// Every new point is sampled around a random active point and checked against the placement grid in O(1), so
+// generating a solution takes O(musicians)
+// If sampling gets stuck before all musicians are placed, the gaps are filled from a hexagonal grid, or the whole stage
+// is covered by one, and if the stage still can't hold all musicians, nothing is returned
+template<typename Rng>
+std::optional<Solution> generateRandomSolution(const std::shared_ptr<Problem> &problem, Rng &rng) {
+    // Number of samples around an active point after which it is considered full
+    constexpr int SAMPLE_ATTEMPTS = 30;
+
+    const auto &stage = problem->stage;
+    std::size_t musicianCount = problem->musicians.size();
+
+    PlacementGrid grid(stage);
+    addEdgePoints(grid, stage);
+
+    std::vector<std::size_t> active(grid.getPlacements().size());
+    for (std::size_t i = 0; i < active.size(); i++) {
+        active[i] = i;
+    }
+
+    if (active.empty() && musicianCount > 0 && stage.isInside(stage.bottomLeft)) {
+        active.emplace_back(grid.add(stage.bottomLeft));
+    }
+
+    std::uniform_real_distribution<double> radiusDist(10, 20);
+    std::uniform_real_distribution<double> angleDist(0, 2 * std::numbers::pi);
+
+    while (grid.getPlacements().size() < musicianCount && !active.empty()) {
+        std::uniform_int_distribution<std::size_t> activeDist(0, active.size() - 1);
+        std::size_t activeIdx = activeDist(rng);
+        Point center = grid.getPlacements()[active[activeIdx]];
+
+        bool sampled = false;
+        for (int attempt = 0; attempt < SAMPLE_ATTEMPTS; attempt++) {
+            double radius = radiusDist(rng);
+            double angle = angleDist(rng);
+            Point point(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle));
+
+            if (grid.canAdd(point)) {
+                active.emplace_back(grid.add(point));
+                sampled = true;
+                break;
+            }
+        }
+
+        if (!sampled) {
+            active[activeIdx] = active.back();
+            active.pop_back();
+        }
+    }
+
+    // Random sampling packs points less densely than a hexagonal grid, so crowded stages fall back to one
+    if (grid.getPlacements().size() < musicianCount) {
+        addHexagonalGridPoints(grid, stage);
+    }
+
+    if (grid.getPlacements().size() < musicianCount) {
+        grid = PlacementGrid(stage);
+        addHexagonalGridPoints(grid, stage);
+    }
+
+    if (grid.getPlacements().size() < musicianCount) {
+        return std::nullopt;
+    }
+
+    std::vector<Point> possiblePlacements = grid.getPlacements();
+    std::shuffle(possiblePlacements.begin(), possiblePlacements.end(), rng);
+
+    std::vector<Point> placements(possiblePlacements.begin(),
+                                  possiblePlacements.begin() + static_cast<std::ptrdiff_t>(musicianCount));
+
+    return Solution(problem, placements);
+}
+
+std::optional<Solution> generateRandomSolution(const std::shared_ptr<Problem> &problem) {
+    std::random_device randomDevice;
+    std::mt19937 rng(randomDevice());
+
+    return generateRandomSolution(problem, rng);
+}
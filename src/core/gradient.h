@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/models.h>
+
+// Returns whether each attendee sees each musician, musician-major at i * attendees.size() + a for attendee a and
+// musician i
+std::vector<char> getVisibility(const Solution &solution, ScoreType type) {
+    const auto &problem = solution.problem;
+    const auto &placements = solution.placements;
+
+    std::size_t musicianCount = placements.size();
+    std::size_t attendeeCount = problem->attendees.size();
+
+    const std::vector<Pillar> *pillars = type == ScoreType::FULL ? &problem->pillars : nullptr;
+
+    std::vector<char> visible(musicianCount * attendeeCount);
+    oneapi::tbb::parallel_for(
+            oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+            [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                VisibilitySweep sweep;
+                for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                    Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+                    sweep.reset(position, placements, pillars, &problem->pillarOcclusions[attendeeIdx]);
+
+                    for (std::size_t i = 0; i < musicianCount; i++) {
+                        visible[i * attendeeCount + attendeeIdx] = !sweep.isBlocked(i);
+                    }
+                }
+            }
+    );
+
+    return visible;
+}
+
+// Returns the gradient of the relaxed score with respect to the placement of every musician
+// The relaxed score is the score without the ceilings, with visibility and volumes fixed at their current values, so
+// it is smooth in the placements: each visible impact is 1e6 * taste / d^2, and closeness factors are 1 + sum 1 / d
+std::vector<Point> getScoreGradient(const Solution &solution, ScoreType type) {
+    const auto &problem = solution.problem;
+    const auto &placements = solution.placements;
+
+    std::size_t musicianCount = placements.size();
+    std::size_t attendeeCount = problem->attendees.size();
+
+    auto visible = getVisibility(solution, type);
+
+    // Total impact of every musician and its gradient, where d(1e6 * taste / d^2) / dx = -2e6 * taste * dx / d^4
+    std::vector<double> impactSums(musicianCount);
+    std::vector<Point> impactGradients(musicianCount);
+
+    oneapi::tbb::parallel_for(std::size_t(0), musicianCount, [&](std::size_t i) {
+        if (solution.volumes[i] == 0) {
+            return;
+        }
+
+        const double *tastes = problem->getMusicianTastes(i);
+        const char *musicianVisible = visible.data() + i * attendeeCount;
+
+        double impactSum = 0;
+        Point impactGradient;
+
+        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+            if (!musicianVisible[attendeeIdx] || tastes[attendeeIdx] == 0) {
+                continue;
+            }
+
+            double dx = placements[i].x - problem->attendeeXs[attendeeIdx];
+            double dy = placements[i].y - problem->attendeeYs[attendeeIdx];
+            double distance2 = dx * dx + dy * dy;
+
+            double impact = 1'000'000.0 * tastes[attendeeIdx] / distance2;
+            impactSum += impact;
+            impactGradient.x -= 2 * impact * dx / distance2;
+            impactGradient.y -= 2 * impact * dy / distance2;
+        }
+
+        impactSums[i] = impactSum;
+        impactGradients[i] = impactGradient;
+    });
+
+    std::vector<Point> gradient(musicianCount);
+    if (type != ScoreType::FULL) {
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            gradient[i] = {solution.volumes[i] * impactGradients[i].x, solution.volumes[i] * impactGradients[i].y};
+        }
+
+        return gradient;
+    }
+
+    // With weighted impacts w_i = volume_i * impactSum_i, the score is sum_i closeness_i * w_i, so moving musician i
+    // changes its own term through its impacts and closeness, and the terms of all musicians playing its instrument
+    // through the closeness term 1 / d_ij they share
+    ClosenessCache closeness(problem->musicians, placements);
+    const auto &closenessFactors = closeness.getFactors();
+
+    oneapi::tbb::parallel_for(std::size_t(0), musicianCount, [&](std::size_t i) {
+        double weightedImpact = solution.volumes[i] * impactSums[i];
+
+        Point musicianGradient(solution.volumes[i] * closenessFactors[i] * impactGradients[i].x,
+                               solution.volumes[i] * closenessFactors[i] * impactGradients[i].y);
+
+        for (std::size_t j : closeness.getGroup(problem->musicians[i])) {
+            if (j == i) {
+                continue;
+            }
+
+            double dx = placements[i].x - placements[j].x;
+            double dy = placements[i].y - placements[j].y;
+            double distance = std::sqrt(dx * dx + dy * dy);
+            double distance3 = distance * distance * distance;
+
+            double sharedWeight = weightedImpact + solution.volumes[j] * impactSums[j];
+            musicianGradient.x -= sharedWeight * dx / distance3;
+            musicianGradient.y -= sharedWeight * dy / distance3;
+        }
+
+        gradient[i] = musicianGradient;
+    });
+
+    return gradient;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file, which is unmapped when the last reference to it is dropped
+class MappedFile {
+    const char *data;
+    std::size_t size;
+
+    MappedFile(const char *data, std::size_t size) : data(data), size(size) {}
+
+public:
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        munmap(const_cast<char *>(data), size);
+    }
+
+    // Returns nullptr if the file can't be opened or mapped, empty files can't be mapped either
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path &file) {
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+            close(fd);
+            return nullptr;
+        }
+
+        auto size = static_cast<std::size_t>(fileStat.st_size);
+        void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (address == MAP_FAILED) {
+            return nullptr;
+        }
+
+        return std::shared_ptr<const MappedFile>(new MappedFile(static_cast<const char *>(address), size));
+    }
+
+    const char *getData() const {
+        return data;
+    }
+
+    std::size_t getSize() const {
+        return size;
+    }
+};
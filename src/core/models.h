@@ -1,19 +1,33 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <charconv>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 #include <memory>
+#include <numbers>
 #include <ostream>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
 #include <oneapi/tbb.h>
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h>
 
+#include <core/blocking.h>
+#include <core/files.h>
+#include <core/mapped.h>
+
 rapidjson::Document readJson(const std::filesystem::path &file) {
     std::FILE *fp = std::fopen(file.c_str(), "r");
 
@@ -27,6 +41,10 @@ rapidjson::Document readJson(const std::filesystem::path &file) {
     return doc;
 }
 
+// std::vector whose storage is aligned to cache lines
+template<typename T>
+using AlignedVector = std::vector<T, oneapi::tbb::cache_aligned_allocator<T>>;
+
 int getIdFromFile(const std::filesystem::path &file) {
     std::string fileName = file.filename();
     std::string extension = file.extension();
@@ -85,6 +103,160 @@ struct Pillar {
     Pillar(const Point &center, double radius) : center(center), radius(radius) {}
 };
 
+// Slack on angular windows to make sure floating point errors never exclude an actual blocker
+constexpr double ANGLE_EPSILON = 1e-9;
+
+// Half-width of the angle under which a circle with the given radius at the given distance can be seen
+double getAngularRadius(double radius, double distance) {
+    if (distance <= radius) {
+        return std::numbers::pi;
+    }
+
+    return std::asin(radius / distance) + ANGLE_EPSILON;
+}
+
+// Angular intervals around a fixed point, e.g. an attendee, in which pillars can block a line of sight towards it
+// The angles are split at every interval boundary and each resulting segment lists the pillars whose interval covers
+// it, so finding the pillars that can block a line of sight is a binary search instead of a scan over all pillars
+// Candidates are tested with isBlocking(), so results are identical to testing every pillar
+class PillarOcclusion {
+    Point origin;
+
+    std::vector<double> boundaries;
+
+    // Pillars covering the angles in [boundaries[s - 1], boundaries[s]) are candidates[segmentStarts[s]] up to
+    // candidates[segmentStarts[s + 1]]
+    std::vector<std::size_t> segmentStarts;
+    std::vector<std::size_t> candidates;
+
+public:
+    PillarOcclusion() = default;
+
+    PillarOcclusion(const Point &origin, const std::vector<Pillar> &pillars) : origin(origin) {
+        constexpr double PI = std::numbers::pi;
+
+        struct Interval {
+            double from;
+            double to;
+            std::size_t pillar;
+        };
+
+        std::vector<Interval> intervals;
+        intervals.reserve(2 * pillars.size());
+
+        for (std::size_t i = 0; i < pillars.size(); i++) {
+            const auto &pillar = pillars[i];
+
+            double angle = getAngle(pillar.center);
+            double window = getAngularRadius(pillar.radius, origin.distanceTo(pillar.center));
+
+            if (window >= PI) {
+                intervals.push_back({-PI, PI, i});
+            } else if (angle - window < -PI) {
+                intervals.push_back({angle - window + 2 * PI, PI, i});
+                intervals.push_back({-PI, angle + window, i});
+            } else if (angle + window > PI) {
+                intervals.push_back({angle - window, PI, i});
+                intervals.push_back({-PI, angle + window - 2 * PI, i});
+            } else {
+                intervals.push_back({angle - window, angle + window, i});
+            }
+        }
+
+        boundaries.reserve(2 * intervals.size());
+        for (const auto &interval : intervals) {
+            boundaries.emplace_back(interval.from);
+            boundaries.emplace_back(interval.to);
+        }
+
+        std::sort(boundaries.begin(), boundaries.end());
+        boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+        // Counting sort of the (segment, pillar) pairs into segmentStarts/candidates
+        std::size_t segmentCount = boundaries.size() + 1;
+        segmentStarts.assign(segmentCount + 1, 0);
+
+        for (const auto &interval : intervals) {
+            for (std::size_t s = getSegment(interval.from); s <= getSegment(interval.to); s++) {
+                segmentStarts[s + 1]++;
+            }
+        }
+
+        for (std::size_t s = 0; s < segmentCount; s++) {
+            segmentStarts[s + 1] += segmentStarts[s];
+        }
+
+        candidates.resize(segmentStarts.back());
+
+        std::vector<std::size_t> nextCandidate(segmentStarts.begin(), segmentStarts.end() - 1);
+        for (const auto &interval : intervals) {
+            for (std::size_t s = getSegment(interval.from); s <= getSegment(interval.to); s++) {
+                candidates[nextCandidate[s]++] = interval.pillar;
+            }
+        }
+    }
+
+    // Returns whether any of the given pillars, which must be the ones the occlusion was built from, blocks the line
+    // of sight between the given point and the origin
+    bool isBlocked(const Point &point, const std::vector<Pillar> &pillars) const {
+        if (candidates.empty()) {
+            return false;
+        }
+
+        std::size_t segment = getSegment(getAngle(point));
+        for (std::size_t k = segmentStarts[segment]; k < segmentStarts[segment + 1]; k++) {
+            const auto &pillar = pillars[candidates[k]];
+            if (isBlocking(point.x, point.y, origin.x, origin.y, pillar.center.x, pillar.center.y, pillar.radius)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    double getAngle(const Point &point) const {
+        return std::atan2(point.y - origin.y, point.x - origin.x);
+    }
+
+    std::size_t getSegment(double angle) const {
+        return static_cast<std::size_t>(std::upper_bound(boundaries.begin(), boundaries.end(), angle)
+                                        - boundaries.begin());
+    }
+};
+
+// Binary problem files hold a problem as it is after loading it from JSON, including the shrunk stage and the flat
+// attendee data, so they can be memory-mapped and used in place
+// The header is followed by sections at the given offsets, which are multiples of 64 bytes so the mapped arrays are
+// aligned to cache lines, and all values are in native byte order
+constexpr std::uint32_t BINARY_PROBLEM_MAGIC = 0x50434649;
+constexpr std::uint32_t BINARY_PROBLEM_VERSION = 1;
+constexpr std::size_t BINARY_PROBLEM_ALIGNMENT = 64;
+
+struct BinaryProblemHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::int32_t id;
+    std::uint32_t reserved;
+
+    Area room;
+    Area stage;
+
+    std::uint64_t musicianCount;
+    std::uint64_t attendeeCount;
+    std::uint64_t instrumentCount;
+    std::uint64_t pillarCount;
+
+    std::uint64_t musiciansOffset;
+    std::uint64_t attendeeXsOffset;
+    std::uint64_t attendeeYsOffset;
+    std::uint64_t tasteMatrixOffset;
+    std::uint64_t instrumentTastesOffset;
+    std::uint64_t pillarsOffset;
+
+    std::uint64_t fileSize;
+};
+
 struct Problem {
     int id;
 
@@ -92,19 +264,42 @@ struct Problem {
     Area stage;
 
     std::vector<int> musicians;
-    std::vector<Attendee> attendees;
     std::vector<Pillar> pillars;
 
+    // Attendees only have positions, their tastes are released once they are copied into the taste matrices, and
+    // attendees of problems loaded from binary files never have any
+    std::vector<Attendee> attendees;
+
+    // Flat copies of the attendee data, so scoring loops stream through contiguous memory
+    // They view either storage owned by the problem, or the mapped binary problem file it was loaded from
+    std::size_t instrumentCount = 0;
+    std::span<const double> attendeeXs;
+    std::span<const double> attendeeYs;
+
+    // Attendee-major taste matrix, the taste of attendee a for instrument k is at a * instrumentCount + k
+    std::span<const double> tasteMatrix;
+
+    // Instrument-major taste matrix, the taste of attendee a for instrument k is at k * attendees.size() + a
+    std::span<const double> instrumentTastes;
+
+    // Pillars never move, so the angles under which they can block the view of each attendee are computed once
+    std::vector<PillarOcclusion> pillarOcclusions;
+
     Problem(int id,
             const Area &room,
             const Area &stage,
             const std::vector<int> &musicians,
             const std::vector<Attendee> &attendees,
             const std::vector<Pillar> &pillars)
-            : id(id), room(room), stage(stage), musicians(musicians), attendees(attendees), pillars(pillars) {
+            : id(id), room(room), stage(stage), musicians(musicians), pillars(pillars), attendees(attendees) {
         postProcessInput();
     }
 
+    // The attendee data views point into the problem's own storage, so problems can't be copied
+    Problem(const Problem &) = delete;
+
+    Problem &operator=(const Problem &) = delete;
+
     explicit Problem(const std::filesystem::path &file) {
         auto data = readJson(file);
 
@@ -155,25 +350,725 @@ struct Problem {
         postProcessInput();
     }
 
+    // Returns the tastes of all attendees for the given musician's instrument, indexed by attendee
+    const double *getMusicianTastes(std::size_t musician) const {
+        return instrumentTastes.data() + static_cast<std::size_t>(musicians[musician]) * attendees.size();
+    }
+
+    // Returns the tastes of the given attendee for all instruments, indexed by instrument
+    const double *getAttendeeTastes(std::size_t attendee) const {
+        return tasteMatrix.data() + attendee * instrumentCount;
+    }
+
+    // Returns whether a pillar blocks the line of sight between the given point and the given attendee
+    bool isPillarBlocked(std::size_t attendee, const Point &point) const {
+        return pillarOcclusions[attendee].isBlocked(point, pillars);
+    }
+
     friend std::ostream &operator<<(std::ostream &stream, const Problem &problem) {
         return stream << "[Problem " << problem.id << "] ";
     }
 
+    // Maps a file written by writeBinary() and uses its attendee data in place
+    // Returns nullptr if the file can't be mapped, or has an unknown format or version
+    static std::shared_ptr<Problem> loadBinary(const std::filesystem::path &file) {
+        auto mappedFile = MappedFile::open(file);
+        if (!mappedFile || mappedFile->getSize() < sizeof(BinaryProblemHeader)) {
+            return nullptr;
+        }
+
+        BinaryProblemHeader header{};
+        std::memcpy(&header, mappedFile->getData(), sizeof(header));
+
+        if (header.magic != BINARY_PROBLEM_MAGIC
+            || header.version != BINARY_PROBLEM_VERSION
+            || header.fileSize != mappedFile->getSize()) {
+            return nullptr;
+        }
+
+        auto tasteCount = header.attendeeCount * header.instrumentCount;
+        auto isSectionValid = [&](std::uint64_t offset, std::uint64_t count, std::size_t elementSize) {
+            return offset % BINARY_PROBLEM_ALIGNMENT == 0
+                   && offset <= header.fileSize
+                   && count <= (header.fileSize - offset) / elementSize;
+        };
+
+        if (!isSectionValid(header.musiciansOffset, header.musicianCount, sizeof(int))
+            || !isSectionValid(header.attendeeXsOffset, header.attendeeCount, sizeof(double))
+            || !isSectionValid(header.attendeeYsOffset, header.attendeeCount, sizeof(double))
+            || !isSectionValid(header.tasteMatrixOffset, tasteCount, sizeof(double))
+            || !isSectionValid(header.instrumentTastesOffset, tasteCount, sizeof(double))
+            || !isSectionValid(header.pillarsOffset, header.pillarCount, sizeof(Pillar))) {
+            return nullptr;
+        }
+
+        const char *data = mappedFile->getData();
+        auto getDoubles = [&](std::uint64_t offset, std::uint64_t count) {
+            return std::span<const double>(reinterpret_cast<const double *>(data + offset), count);
+        };
+
+        std::shared_ptr<Problem> problem(new Problem());
+        problem->id = header.id;
+        problem->room = header.room;
+        problem->stage = header.stage;
+
+        problem->musicians.resize(header.musicianCount);
+        std::memcpy(problem->musicians.data(), data + header.musiciansOffset, header.musicianCount * sizeof(int));
+
+        problem->pillars.resize(header.pillarCount);
+        std::memcpy(problem->pillars.data(), data + header.pillarsOffset, header.pillarCount * sizeof(Pillar));
+
+        for (int instrument : problem->musicians) {
+            if (instrument < 0 || static_cast<std::uint64_t>(instrument) >= header.instrumentCount) {
+                return nullptr;
+            }
+        }
+
+        problem->instrumentCount = header.instrumentCount;
+        problem->attendeeXs = getDoubles(header.attendeeXsOffset, header.attendeeCount);
+        problem->attendeeYs = getDoubles(header.attendeeYsOffset, header.attendeeCount);
+        problem->tasteMatrix = getDoubles(header.tasteMatrixOffset, tasteCount);
+        problem->instrumentTastes = getDoubles(header.instrumentTastesOffset, tasteCount);
+        problem->mappedFile = mappedFile;
+
+        problem->attendees.resize(header.attendeeCount);
+        for (std::size_t i = 0; i < header.attendeeCount; i++) {
+            problem->attendees[i].position = {problem->attendeeXs[i], problem->attendeeYs[i]};
+        }
+
+        problem->buildPillarOcclusions();
+        return problem;
+    }
+
+    // Writes the problem atomically in the format read by loadBinary()
+    bool writeBinary(const std::filesystem::path &file) const {
+        BinaryProblemHeader header{};
+        header.magic = BINARY_PROBLEM_MAGIC;
+        header.version = BINARY_PROBLEM_VERSION;
+        header.id = id;
+        header.room = room;
+        header.stage = stage;
+        header.musicianCount = musicians.size();
+        header.attendeeCount = attendees.size();
+        header.instrumentCount = instrumentCount;
+        header.pillarCount = pillars.size();
+
+        std::string buffer(sizeof(header), '\0');
+        auto appendSection = [&](const void *values, std::size_t size) {
+            buffer.resize((buffer.size() + BINARY_PROBLEM_ALIGNMENT - 1) / BINARY_PROBLEM_ALIGNMENT
+                          * BINARY_PROBLEM_ALIGNMENT, '\0');
+
+            std::uint64_t offset = buffer.size();
+            buffer.append(static_cast<const char *>(values), size);
+            return offset;
+        };
+
+        header.musiciansOffset = appendSection(musicians.data(), musicians.size() * sizeof(int));
+        header.attendeeXsOffset = appendSection(attendeeXs.data(), attendeeXs.size_bytes());
+        header.attendeeYsOffset = appendSection(attendeeYs.data(), attendeeYs.size_bytes());
+        header.tasteMatrixOffset = appendSection(tasteMatrix.data(), tasteMatrix.size_bytes());
+        header.instrumentTastesOffset = appendSection(instrumentTastes.data(), instrumentTastes.size_bytes());
+        header.pillarsOffset = appendSection(pillars.data(), pillars.size() * sizeof(Pillar));
+        header.fileSize = buffer.size();
+
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        return writeFileAtomically(file, buffer);
+    }
+
 private:
+    AlignedVector<double> ownedAttendeeXs;
+    AlignedVector<double> ownedAttendeeYs;
+    AlignedVector<double> ownedTasteMatrix;
+    AlignedVector<double> ownedInstrumentTastes;
+
+    std::shared_ptr<const MappedFile> mappedFile;
+
+    Problem() : id(0) {}
+
     void postProcessInput() {
         stage.bottomLeft.x += 10;
         stage.bottomLeft.y += 10;
         stage.width -= 20;
         stage.height -= 20;
+
+        std::size_t attendeeCount = attendees.size();
+        instrumentCount = attendees.empty() ? 0 : attendees[0].tastes.size();
+
+        ownedAttendeeXs.resize(attendeeCount);
+        ownedAttendeeYs.resize(attendeeCount);
+        ownedTasteMatrix.resize(attendeeCount * instrumentCount);
+        ownedInstrumentTastes.resize(attendeeCount * instrumentCount);
+
+        for (std::size_t i = 0; i < attendeeCount; i++) {
+            auto &attendee = attendees[i];
+
+            ownedAttendeeXs[i] = attendee.position.x;
+            ownedAttendeeYs[i] = attendee.position.y;
+
+            for (std::size_t instrument = 0; instrument < instrumentCount; instrument++) {
+                ownedTasteMatrix[i * instrumentCount + instrument] = attendee.tastes[instrument];
+                ownedInstrumentTastes[instrument * attendeeCount + i] = attendee.tastes[instrument];
+            }
+
+            // Swapping releases the memory, clearing would keep the capacity
+            std::vector<double>().swap(attendee.tastes);
+        }
+
+        attendeeXs = ownedAttendeeXs;
+        attendeeYs = ownedAttendeeYs;
+        tasteMatrix = ownedTasteMatrix;
+        instrumentTastes = ownedInstrumentTastes;
+
+        buildPillarOcclusions();
+    }
+
+    void buildPillarOcclusions() {
+        std::size_t attendeeCount = attendees.size();
+
+        pillarOcclusions.resize(attendeeCount);
+        if (!pillars.empty()) {
+            oneapi::tbb::parallel_for(
+                    oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                    [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                        for (std::size_t i = range.begin(); i != range.end(); i++) {
+                            pillarOcclusions[i] = PillarOcclusion(attendees[i].position, pillars);
+                        }
+                    }
+            );
+        }
+    }
+};
+
+bool isBlocking(const Point &from, const Point &to, const Point &blockingCenter, double blockingRadius) {
+    return isBlocking(from.x, from.y, to.x, to.y, blockingCenter.x, blockingCenter.y, blockingRadius);
+}
+
+// Determines which musicians are visible from a single attendee
+// Musicians are sorted by their angle around the attendee, so that finding the blockers of a line of sight only
+// requires testing the musicians whose angular extent can contain it, instead of scanning all of them
+// Pillars are looked up in the attendee's PillarOcclusion
+// Candidates are tested with countBlocking() and isBlocking(), which agree bit for bit, so results are identical to
+// testing every musician and pillar
+class VisibilitySweep {
+    static constexpr double PI = std::numbers::pi;
+
+    Point origin;
+    const std::vector<Point> *placements = nullptr;
+    const std::vector<Pillar> *pillars = nullptr;
+    const PillarOcclusion *occlusion = nullptr;
+    PillarOcclusion localOcclusion;
+
+    // Musicians sorted by angle, with their coordinates mirrored in sorted order for the batched blocking kernel
+    std::vector<std::pair<double, std::size_t>> musicianOrder;
+    std::vector<double> sortedAngles;
+    std::vector<double> sortedXs;
+    std::vector<double> sortedYs;
+    std::vector<std::size_t> ranks;
+
+    double musicianWindow = 0;
+
+public:
+    // Prepares the sweep for the given attendee position, pillars are only taken into account if non-null
+    // The pillar occlusion of the attendee is built on the fly if not given
+    void reset(const Point &attendee,
+               const std::vector<Point> &musicianPlacements,
+               const std::vector<Pillar> *problemPillars,
+               const PillarOcclusion *pillarOcclusion = nullptr) {
+        origin = attendee;
+        placements = &musicianPlacements;
+        pillars = problemPillars;
+        occlusion = pillarOcclusion;
+
+        if (pillars != nullptr && occlusion == nullptr) {
+            localOcclusion = PillarOcclusion(origin, *pillars);
+            occlusion = &localOcclusion;
+        }
+
+        std::size_t musicianCount = placements->size();
+
+        musicianOrder.clear();
+        musicianOrder.reserve(musicianCount);
+
+        double minDistance = std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            const auto &placement = (*placements)[i];
+
+            musicianOrder.emplace_back(getAngle(placement), i);
+            minDistance = std::min(minDistance, origin.distanceTo(placement));
+        }
+
+        std::sort(musicianOrder.begin(), musicianOrder.end());
+        musicianWindow = getAngularRadius(5, minDistance);
+
+        sortedAngles.resize(musicianCount);
+        sortedXs.resize(musicianCount);
+        sortedYs.resize(musicianCount);
+        ranks.resize(musicianCount);
+
+        for (std::size_t rank = 0; rank < musicianCount; rank++) {
+            const auto &[angle, i] = musicianOrder[rank];
+
+            sortedAngles[rank] = angle;
+            sortedXs[rank] = (*placements)[i].x;
+            sortedYs[rank] = (*placements)[i].y;
+            ranks[i] = rank;
+        }
+    }
+
+    bool isBlocked(std::size_t musician) const {
+        const auto &placement = (*placements)[musician];
+        std::size_t rank = ranks[musician];
+
+        auto anyMusicianBlocking = [&](std::size_t from, std::size_t to) {
+            return countBlocking(placement.x, placement.y, origin.x, origin.y,
+                                 sortedXs.data(), sortedYs.data(), from, to, rank, 5, true) > 0;
+        };
+
+        if (anyInWindow(sortedAngles, sortedAngles[rank], musicianWindow, anyMusicianBlocking)) {
+            return true;
+        }
+
+        return pillars != nullptr && occlusion->isBlocked(placement, *pillars);
+    }
+
+    // Returns the number of other musicians blocking the line of sight between the given musician and the attendee
+    int countBlockers(std::size_t musician) const {
+        const auto &placement = (*placements)[musician];
+        std::size_t rank = ranks[musician];
+
+        std::size_t count = 0;
+        anyInWindow(sortedAngles, sortedAngles[rank], musicianWindow, [&](std::size_t from, std::size_t to) {
+            count += countBlocking(placement.x, placement.y, origin.x, origin.y,
+                                   sortedXs.data(), sortedYs.data(), from, to, rank, 5);
+            return false;
+        });
+
+        return static_cast<int>(count);
+    }
+
+private:
+    double getAngle(const Point &point) const {
+        return std::atan2(point.y - origin.y, point.x - origin.x);
+    }
+
+    // Calls the callback with the index ranges of the sorted angles within the window around the given angle
+    // Returns true as soon as the callback returns true
+    template<typename Callback>
+    static bool anyInWindow(const std::vector<double> &angles, double angle, double window, Callback callback) {
+        if (window >= PI) {
+            return callback(0, angles.size());
+        }
+
+        double from = angle - window;
+        double to = angle + window;
+
+        if (from < -PI && anyInRange(angles, from + 2 * PI, PI, callback)) {
+            return true;
+        }
+
+        if (to > PI && anyInRange(angles, -PI, to - 2 * PI, callback)) {
+            return true;
+        }
+
+        return anyInRange(angles, from, to, callback);
+    }
+
+    template<typename Callback>
+    static bool anyInRange(const std::vector<double> &angles, double from, double to, Callback &callback) {
+        auto begin = std::lower_bound(angles.begin(), angles.end(), from);
+        auto end = std::upper_bound(begin, angles.end(), to);
+
+        if (begin == end) {
+            return false;
+        }
+
+        auto fromIdx = static_cast<std::size_t>(begin - angles.begin());
+        auto toIdx = static_cast<std::size_t>(end - angles.begin());
+        return callback(fromIdx, toIdx);
+    }
+};
+
+// Closeness factors of all musicians, with musicians bucketed by instrument
+// Moving a musician only changes the factors of the musicians playing the same instrument, which are updated in
+// O(group size) by replacing the moved musician's term in each of their sums
+class ClosenessCache {
+    // Number of incremental updates after which a group is recomputed from scratch, so rounding errors don't pile up
+    static constexpr std::size_t RESYNC_INTERVAL = 1024;
+
+    std::vector<int> instruments;
+    std::vector<std::vector<std::size_t>> groups;
+    std::vector<std::size_t> groupUpdates;
+
+    std::vector<Point> placements;
+    std::vector<double> factors;
+
+public:
+    ClosenessCache() = default;
+
+    ClosenessCache(const std::vector<int> &instruments, const std::vector<Point> &placements)
+            : instruments(instruments), placements(placements), factors(placements.size()) {
+        assert(instruments.size() == placements.size());
+
+        int maxInstrument = instruments.empty() ? -1 : *std::max_element(instruments.begin(), instruments.end());
+        groups.resize(static_cast<std::size_t>(maxInstrument + 1));
+        groupUpdates.resize(groups.size());
+
+        for (std::size_t i = 0; i < instruments.size(); i++) {
+            groups[instruments[i]].emplace_back(i);
+        }
+
+        for (std::size_t instrument = 0; instrument < groups.size(); instrument++) {
+            recomputeGroup(static_cast<int>(instrument), factors);
+        }
+    }
+
+    const std::vector<double> &getFactors() const {
+        return factors;
+    }
+
+    const std::vector<std::size_t> &getGroup(int instrument) const {
+        return groups[instrument];
+    }
+
+    // Writes the factors after moving the given musician to the given placement into target
+    // Only the factors of musicians playing the moved musician's instrument are written, the rest of target is kept
+    void getMovedFactors(std::size_t musician, const Point &placement, std::vector<double> &target) const {
+        int instrument = instruments[musician];
+        if (needsResync(instrument)) {
+            recomputeGroup(instrument, musician, placement, target);
+            return;
+        }
+
+        const Point &oldPlacement = placements[musician];
+
+        double closeness = 1;
+        for (std::size_t j : groups[instrument]) {
+            if (j == musician) {
+                continue;
+            }
+
+            double term = 1.0 / placement.distanceTo(placements[j]);
+            target[j] = factors[j] + (term - 1.0 / oldPlacement.distanceTo(placements[j]));
+            closeness += term;
+        }
+
+        target[musician] = closeness;
+    }
+
+    // Writes the factors after swapping the placements of the given musicians into target
+    void getSwappedFactors(std::size_t musician1, std::size_t musician2, std::vector<double> &target) const {
+        if (instruments[musician1] == instruments[musician2]) {
+            double factor1 = factors[musician1];
+            double factor2 = factors[musician2];
+            target[musician1] = factor2;
+            target[musician2] = factor1;
+            return;
+        }
+
+        // The musicians are in different groups, so each move only affects the group of the moved musician
+        getMovedFactors(musician1, placements[musician2], target);
+        getMovedFactors(musician2, placements[musician1], target);
+    }
+
+    void move(std::size_t musician, const Point &placement) {
+        getMovedFactors(musician, placement, factors);
+        countUpdate(instruments[musician]);
+
+        placements[musician] = placement;
+    }
+
+    void swap(std::size_t musician1, std::size_t musician2) {
+        getSwappedFactors(musician1, musician2, factors);
+
+        if (instruments[musician1] != instruments[musician2]) {
+            countUpdate(instruments[musician1]);
+            countUpdate(instruments[musician2]);
+        }
+
+        std::swap(placements[musician1], placements[musician2]);
+    }
+
+private:
+    bool needsResync(int instrument) const {
+        return groupUpdates[instrument] + 1 >= RESYNC_INTERVAL;
+    }
+
+    void countUpdate(int instrument) {
+        groupUpdates[instrument] = needsResync(instrument) ? 0 : groupUpdates[instrument] + 1;
+    }
+
+    // Recomputes the factors of a group from scratch
+    void recomputeGroup(int instrument, std::vector<double> &target) const {
+        recomputeGroupWith(instrument, target, [&](std::size_t i) -> const Point & {
+            return placements[i];
+        });
+    }
+
+    // Recomputes the factors of a group from scratch, as if musician moved was placed at movedPlacement
+    void recomputeGroup(int instrument,
+                        std::size_t moved,
+                        const Point &movedPlacement,
+                        std::vector<double> &target) const {
+        recomputeGroupWith(instrument, target, [&](std::size_t i) -> const Point & {
+            return i == moved ? movedPlacement : placements[i];
+        });
+    }
+
+    // Terms are summed in musician order, so results are identical to summing over all musicians
+    template<typename GetPlacement>
+    void recomputeGroupWith(int instrument, std::vector<double> &target, GetPlacement getPlacement) const {
+        const auto &group = groups[instrument];
+
+        for (std::size_t i : group) {
+            const Point &from = getPlacement(i);
+
+            double closeness = 1;
+            for (std::size_t j : group) {
+                if (i != j) {
+                    closeness += 1.0 / from.distanceTo(getPlacement(j));
+                }
+            }
+
+            target[i] = closeness;
+        }
+    }
+};
+
+// Uniform grid over the stage with cells as large as the minimum distance between musicians, so that the only
+// placements that can be too close to a point are the ones in its own cell and the 8 cells around it
+class PlacementGrid {
+    static constexpr double CELL_SIZE = 10;
+
+    Area stage;
+    std::size_t columns;
+    std::size_t rows;
+
+    std::vector<std::vector<std::size_t>> cells;
+    std::vector<Point> placements;
+    std::vector<std::size_t> placementCells;
+
+public:
+    explicit PlacementGrid(const Area &stage, const std::vector<Point> &initialPlacements = {})
+            : stage(stage),
+              columns(static_cast<std::size_t>(std::max(stage.width, 0.0) / CELL_SIZE) + 1),
+              rows(static_cast<std::size_t>(std::max(stage.height, 0.0) / CELL_SIZE) + 1),
+              cells(columns * rows) {
+        placements.reserve(initialPlacements.size());
+        placementCells.reserve(initialPlacements.size());
+
+        for (const auto &placement : initialPlacements) {
+            add(placement);
+        }
+    }
+
+    const std::vector<Point> &getPlacements() const {
+        return placements;
+    }
+
+    // Returns whether all placements are on the stage and not too close to each other
+    bool isValid() const {
+        for (std::size_t i = 0; i < placements.size(); i++) {
+            if (!canMove(i, placements[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Returns whether a new placement at the given point would be valid
+    bool canAdd(const Point &point) const {
+        return stage.isInside(point) && isFree(point, placements.size());
+    }
+
+    // Returns whether moving the given placement to the given point would be valid
+    bool canMove(std::size_t index, const Point &point) const {
+        return stage.isInside(point) && isFree(point, index);
+    }
+
+    std::size_t add(const Point &point) {
+        std::size_t cell = getCell(point);
+
+        cells[cell].emplace_back(placements.size());
+        placements.emplace_back(point);
+        placementCells.emplace_back(cell);
+
+        return placements.size() - 1;
+    }
+
+    void move(std::size_t index, const Point &point) {
+        std::size_t oldCell = placementCells[index];
+        std::size_t newCell = getCell(point);
+
+        if (newCell != oldCell) {
+            auto &oldMembers = cells[oldCell];
+            oldMembers.erase(std::find(oldMembers.begin(), oldMembers.end(), index));
+
+            cells[newCell].emplace_back(index);
+            placementCells[index] = newCell;
+        }
+
+        placements[index] = point;
+    }
+
+    void swap(std::size_t index1, std::size_t index2) {
+        Point placement1 = placements[index1];
+        move(index1, placements[index2]);
+        move(index2, placement1);
+    }
+
+private:
+    std::size_t getColumn(double x) const {
+        double column = std::floor((x - stage.bottomLeft.x) / CELL_SIZE);
+        return static_cast<std::size_t>(std::clamp(column, 0.0, static_cast<double>(columns - 1)));
+    }
+
+    std::size_t getRow(double y) const {
+        double row = std::floor((y - stage.bottomLeft.y) / CELL_SIZE);
+        return static_cast<std::size_t>(std::clamp(row, 0.0, static_cast<double>(rows - 1)));
+    }
+
+    std::size_t getCell(const Point &point) const {
+        return getRow(point.y) * columns + getColumn(point.x);
+    }
+
+    // Returns whether no placement other than skip is too close to the given point
+    bool isFree(const Point &point, std::size_t skip) const {
+        std::size_t column = getColumn(point.x);
+        std::size_t row = getRow(point.y);
+
+        for (std::size_t r = row == 0 ? 0 : row - 1; r <= std::min(row + 1, rows - 1); r++) {
+            for (std::size_t c = column == 0 ? 0 : column - 1; c <= std::min(column + 1, columns - 1); c++) {
+                for (std::size_t j : cells[r * columns + c]) {
+                    if (j != skip && placements[j].distanceTo2(point) < 100) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+// Returns whether all placements are on the stage and not too close to each other, like PlacementGrid::isValid()
+// Instead of a grid over the whole stage, the placements are sorted by the 10x10 cell they are in, so it only takes
+// memory and time for the placements themselves, and every placement is compared to the few in neighboring cells
+bool arePlacementsValid(const Area &stage, const std::vector<Point> &placements) {
+    auto getCellKey = [](std::uint64_t row, std::uint64_t column) {
+        return row << 32 | column;
+    };
+
+    std::vector<std::pair<std::uint64_t, std::size_t>> cellPlacements;
+    cellPlacements.reserve(placements.size());
+
+    for (std::size_t i = 0; i < placements.size(); i++) {
+        const auto &placement = placements[i];
+        if (!stage.isInside(placement)) {
+            return false;
+        }
+
+        auto row = static_cast<std::uint64_t>((placement.y - stage.bottomLeft.y) / 10);
+        auto column = static_cast<std::uint64_t>((placement.x - stage.bottomLeft.x) / 10);
+        cellPlacements.emplace_back(getCellKey(row, column), i);
+    }
+
+    std::sort(cellPlacements.begin(), cellPlacements.end());
+
+    for (const auto &[key, i] : cellPlacements) {
+        std::uint64_t row = key >> 32;
+        std::uint64_t column = key & 0xFFFFFFFF;
+
+        // Placements in earlier cells already compared themselves to this one
+        for (std::uint64_t r = row; r <= row + 1; r++) {
+            for (std::uint64_t c = column == 0 ? 0 : column - 1; c <= column + 1; c++) {
+                auto neighborKey = getCellKey(r, c);
+                if (neighborKey < key) {
+                    continue;
+                }
+
+                auto it = std::lower_bound(cellPlacements.begin(), cellPlacements.end(),
+                                           std::make_pair(neighborKey, std::size_t{0}));
+                for (; it != cellPlacements.end() && it->first == neighborKey; it++) {
+                    if (it->second != i && placements[it->second].distanceTo2(placements[i]) < 100) {
+                        return false;
+                    }
+                }
+            }
+        }
     }
+
+    return true;
+}
+
+// Grain sizes of the (attendee, musician) tiles scored in parallel by Solution::getScore()
+struct ScoreTiling {
+    std::size_t attendeeGrain;
+    std::size_t musicianGrain;
 };
 
+// Returns the size of the per-core L2 cache in bytes, or a typical size if it can't be determined
+std::size_t getL2CacheSize() {
+    static const std::size_t size = [] {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        long result = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (result > 0) {
+            return static_cast<std::size_t>(result);
+        }
+#endif
+
+        return static_cast<std::size_t>(1024 * 1024);
+    }();
+
+    return size;
+}
+
+// With enough attendees, every tile covers all musicians of a single attendee, which is enough to keep all threads busy
+// With few attendees, the musicians are split into column tiles as well, so that there are a few tiles per thread,
+// but never into tiles with fewer than MIN_MUSICIAN_GRAIN musicians or more musicians than fit in the L2 cache
+ScoreTiling getScoreTiling(std::size_t attendeeCount,
+                           std::size_t musicianCount,
+                           std::size_t threadCount = static_cast<std::size_t>(
+                                   oneapi::tbb::this_task_arena::max_concurrency())) {
+    constexpr std::size_t TILES_PER_THREAD = 8;
+    constexpr std::size_t MIN_MUSICIAN_GRAIN = 64;
+
+    // Placement, instrument, closeness factor and sweep entry of a musician, plus its sums in the volume optimization
+    constexpr std::size_t BYTES_PER_MUSICIAN = 128;
+
+    std::size_t targetTiles = TILES_PER_THREAD * std::max<std::size_t>(threadCount, 1);
+    if (attendeeCount >= targetTiles || musicianCount <= MIN_MUSICIAN_GRAIN) {
+        return {1, std::max<std::size_t>(musicianCount, 1)};
+    }
+
+    std::size_t tilesPerAttendee = (targetTiles + attendeeCount - 1) / std::max<std::size_t>(attendeeCount, 1);
+    std::size_t musicianGrain = (musicianCount + tilesPerAttendee - 1) / tilesPerAttendee;
+
+    musicianGrain = std::min(musicianGrain, getL2CacheSize() / BYTES_PER_MUSICIAN);
+    musicianGrain = std::max(musicianGrain, MIN_MUSICIAN_GRAIN);
+
+    return {1, musicianGrain};
+}
+
 enum class ScoreType {
     AUTO,
     LIGHTNING,
     FULL
 };
 
+// Appends the shortest representation of value that parses back to the same double
+// Integral values get a fractional part like rapidjson writes them, so they are still read back as doubles
+void appendJsonDouble(std::string &buffer, double value) {
+    char chars[32];
+    auto result = std::to_chars(chars, chars + sizeof(chars), value);
+    buffer.append(chars, result.ptr);
+
+    if (std::all_of(chars, result.ptr, [](char c) { return c == '-' || (c >= '0' && c <= '9'); })) {
+        buffer += ".0";
+    }
+}
+
 struct Solution {
     std::shared_ptr<Problem> problem;
     std::vector<Point> placements;
@@ -222,18 +1117,8 @@ struct Solution {
             return false;
         }
 
-        for (const auto &placement : placements) {
-            if (!problem->stage.isInside(placement)) {
-                return false;
-            }
-        }
-
-        for (std::size_t i = 0; i < placements.size(); i++) {
-            for (std::size_t j = 0; j < placements.size(); j++) {
-                if (i != j && placements[i].distanceTo2(placements[j]) < 100) {
-                    return false;
-                }
-            }
+        if (!arePlacementsValid(problem->stage, placements)) {
+            return false;
         }
 
         if (problem->musicians.size() != volumes.size()) {
@@ -254,73 +1139,87 @@ struct Solution {
             type = problem->id <= 55 ? ScoreType::LIGHTNING : ScoreType::FULL;
         }
 
-        std::vector<double> closenessFactors;
+        ClosenessCache closeness;
         if (type == ScoreType::FULL) {
-            closenessFactors.reserve(placements.size());
-            for (std::size_t i = 0; i < placements.size(); i++) {
-                double closeness = 1;
+            closeness = ClosenessCache(problem->musicians, placements);
+        }
 
-                for (std::size_t j = 0; j < placements.size(); j++) {
-                    if (i != j && problem->musicians[i] == problem->musicians[j]) {
-                        closeness += 1.0 / placements[i].distanceTo(placements[j]);
-                    }
-                }
+        const auto &closenessFactors = closeness.getFactors();
 
-                closenessFactors.emplace_back(closeness);
-            }
-        }
+        const std::vector<Pillar> *pillars = type == ScoreType::FULL ? &problem->pillars : nullptr;
 
-        if (!optimizeVolumes) {
-            return oneapi::tbb::parallel_reduce(
-                    oneapi::tbb::blocked_range<std::size_t>(0, problem->attendees.size()),
-                    static_cast<long long>(0),
-                    [&](const oneapi::tbb::blocked_range<std::size_t> &range, long long init) {
+        std::size_t attendeeCount = problem->attendees.size();
+        std::size_t musicianCount = placements.size();
+
+        // When tiles split the musicians of an attendee over multiple threads, the visibility sweep of every attendee
+        // is prepared once up front instead of by every tile
+        auto tiling = getScoreTiling(attendeeCount, musicianCount);
+
+        std::vector<VisibilitySweep> sweeps;
+        if (tiling.musicianGrain < musicianCount) {
+            sweeps.resize(attendeeCount);
+            oneapi::tbb::parallel_for(
+                    oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                    [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
                         for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
-                            const auto &attendee = problem->attendees[attendeeIdx];
-                            for (std::size_t i = 0; i < placements.size(); i++) {
-                                if (attendee.tastes[problem->musicians[i]] == 0) {
-                                    continue;
-                                }
+                            Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+                            sweeps[attendeeIdx].reset(position, placements, pillars,
+                                                      &problem->pillarOcclusions[attendeeIdx]);
+                        }
+                    }
+            );
+        }
 
-                                bool isBlocked = false;
-                                for (std::size_t j = 0; j < placements.size(); j++) {
-                                    if (i != j && isBlocking(placements[i], attendee.position, placements[j], 5)) {
-                                        isBlocked = true;
-                                        break;
-                                    }
-                                }
+        oneapi::tbb::blocked_range2d<std::size_t> pairs(0, attendeeCount, tiling.attendeeGrain,
+                                                        0, musicianCount, tiling.musicianGrain);
 
-                                if (isBlocked) {
-                                    continue;
-                                }
+        // Calls visit(i, impact) for every musician in the tile that is visible from the tile's attendees
+        auto visitTile = [&](const oneapi::tbb::blocked_range2d<std::size_t> &tile, auto &&visit) {
+            VisibilitySweep localSweep;
 
-                                if (type == ScoreType::FULL) {
-                                    for (const auto &pillar : problem->pillars) {
-                                        if (isBlocking(
-                                                placements[i], attendee.position, pillar.center, pillar.radius)) {
-                                            isBlocked = true;
-                                            break;
-                                        }
-                                    }
-
-                                    if (isBlocked) {
-                                        continue;
-                                    }
-                                }
+            for (std::size_t attendeeIdx = tile.rows().begin(); attendeeIdx != tile.rows().end(); attendeeIdx++) {
+                Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+                const double *tastes = problem->getAttendeeTastes(attendeeIdx);
 
-                                double volume = volumes[i];
+                const VisibilitySweep *sweep = &localSweep;
+                if (sweeps.empty()) {
+                    localSweep.reset(position, placements, pillars, &problem->pillarOcclusions[attendeeIdx]);
+                } else {
+                    sweep = &sweeps[attendeeIdx];
+                }
 
-                                double taste = 1'000'000.0 * attendee.tastes[problem->musicians[i]];
-                                double distance = attendee.position.distanceTo2(placements[i]);
-                                double impact = std::ceil(taste / distance);
+                for (std::size_t i = tile.cols().begin(); i != tile.cols().end(); i++) {
+                    if (tastes[problem->musicians[i]] == 0) {
+                        continue;
+                    }
 
-                                if (type == ScoreType::LIGHTNING) {
-                                    init += std::ceil(volume * impact);
-                                } else {
-                                    init += std::ceil(volume * closenessFactors[i] * impact);
-                                }
+                    if (sweep->isBlocked(i)) {
+                        continue;
+                    }
+
+                    double taste = 1'000'000.0 * tastes[problem->musicians[i]];
+                    double distance = position.distanceTo2(placements[i]);
+                    visit(i, std::ceil(taste / distance));
+                }
+            }
+        };
+
+        // All partial results below are integers, so the reductions are exact and independent of the tiling and of
+        // the order in which tiles are combined
+        if (!optimizeVolumes) {
+            return oneapi::tbb::parallel_reduce(
+                    pairs,
+                    static_cast<long long>(0),
+                    [&](const oneapi::tbb::blocked_range2d<std::size_t> &tile, long long init) {
+                        visitTile(tile, [&](std::size_t i, double impact) {
+                            double volume = volumes[i];
+
+                            if (type == ScoreType::LIGHTNING) {
+                                init += std::ceil(volume * impact);
+                            } else {
+                                init += std::ceil(volume * closenessFactors[i] * impact);
                             }
-                        }
+                        });
 
                         return init;
                     },
@@ -330,85 +1229,41 @@ struct Solution {
             );
         }
 
-        auto scoresByMusician = oneapi::tbb::parallel_reduce(
-                oneapi::tbb::blocked_range<std::size_t>(0, problem->attendees.size()),
-                std::vector<std::vector<double>>(placements.size()),
-                [&](const oneapi::tbb::blocked_range<std::size_t> &range, std::vector<std::vector<double>> init) {
-                    for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
-                        const auto &attendee = problem->attendees[attendeeIdx];
-                        for (std::size_t i = 0; i < placements.size(); i++) {
-                            if (attendee.tastes[problem->musicians[i]] == 0) {
-                                continue;
-                            }
-
-                            bool isBlocked = false;
-                            for (std::size_t j = 0; j < placements.size(); j++) {
-                                if (i != j && isBlocking(placements[i], attendee.position, placements[j], 5)) {
-                                    isBlocked = true;
-                                    break;
-                                }
-                            }
-
-                            if (isBlocked) {
-                                continue;
-                            }
-
-                            if (type == ScoreType::FULL) {
-                                for (const auto &pillar : problem->pillars) {
-                                    if (isBlocking(placements[i], attendee.position, pillar.center, pillar.radius)) {
-                                        isBlocked = true;
-                                        break;
-                                    }
-                                }
-
-                                if (isBlocked) {
-                                    continue;
-                                }
-                            }
+        // The volume of each musician only depends on the sign of its total impact, so instead of collecting every
+        // individual impact, each thread keeps a running sum of every musician's impact and of its score at volume 10
+        oneapi::tbb::combinable<std::vector<double>> musicianSums([&] {
+            return std::vector<double>(2 * musicianCount);
+        });
 
-                            double taste = 1'000'000.0 * attendee.tastes[problem->musicians[i]];
-                            double distance = attendee.position.distanceTo2(placements[i]);
-                            double impact = std::ceil(taste / distance);
+        oneapi::tbb::parallel_for(pairs, [&](const oneapi::tbb::blocked_range2d<std::size_t> &tile) {
+            auto &sums = musicianSums.local();
 
-                            if (type == ScoreType::LIGHTNING) {
-                                init[i].emplace_back(impact);
-                            } else {
-                                init[i].emplace_back(closenessFactors[i] * impact);
-                            }
-                        }
-                    }
+            visitTile(tile, [&](std::size_t i, double impact) {
+                double score = type == ScoreType::LIGHTNING ? impact : closenessFactors[i] * impact;
 
-                    return init;
-                },
-                [](const std::vector<std::vector<double>> &lhs, const std::vector<std::vector<double>> &rhs) {
-                    std::vector<std::vector<double>> scores(lhs.size());
-                    for (std::size_t i = 0; i < lhs.size(); i++) {
-                        scores[i].insert(scores[i].end(), lhs[i].begin(), lhs[i].end());
-                        scores[i].insert(scores[i].end(), rhs[i].begin(), rhs[i].end());
-                    }
+                sums[2 * i] += impact;
+                sums[2 * i + 1] += std::ceil(10.0 * score);
+            });
+        });
 
-                    return scores;
-                }
-        );
+        std::vector<double> totalSums(2 * placements.size());
+        musicianSums.combine_each([&](const std::vector<double> &sums) {
+            for (std::size_t i = 0; i < sums.size(); i++) {
+                totalSums[i] += sums[i];
+            }
+        });
 
         long long totalScore = 0;
 
         volumes.clear();
         volumes.reserve(placements.size());
 
-        for (const auto &scores : scoresByMusician) {
-            double musicianScore = 0;
-            for (auto score : scores) {
-                musicianScore += score;
-            }
-
-            if (musicianScore <= 0) {
+        for (std::size_t i = 0; i < placements.size(); i++) {
+            if (totalSums[2 * i] <= 0) {
                 volumes.emplace_back(0);
             } else {
                 volumes.emplace_back(10);
-                for (auto score : scores) {
-                    totalScore += std::ceil(10.0 * score);
-                }
+                totalScore += static_cast<long long>(totalSums[2 * i + 1]);
             }
         }
 
@@ -454,38 +1309,498 @@ struct Solution {
         return doc;
     }
 
+    // Appends the same JSON as toJson() to buffer without building a document, so a buffer that is reused between
+    // solutions serializes them without any allocations
+    void appendJson(std::string &buffer) const {
+        buffer.reserve(buffer.size() + 32 + placements.size() * 56 + volumes.size() * 24);
+
+        buffer += "{\"placements\":[";
+        for (std::size_t i = 0; i < placements.size(); i++) {
+            buffer += i == 0 ? "{\"x\":" : ",{\"x\":";
+            appendJsonDouble(buffer, placements[i].x);
+            buffer += ",\"y\":";
+            appendJsonDouble(buffer, placements[i].y);
+            buffer += '}';
+        }
+
+        buffer += "],\"volumes\":[";
+        for (std::size_t i = 0; i < volumes.size(); i++) {
+            if (i > 0) {
+                buffer += ',';
+            }
+
+            appendJsonDouble(buffer, volumes[i]);
+        }
+
+        buffer += "]}";
+    }
+};
+
+// Keeps the per-(musician, attendee) visibility and impact state of a solution, so that moving a single musician can
+// be re-scored in O(attendees * musicians) instead of running Solution::getScore() from scratch.
+// Swapping two musicians leaves the set of occupied points unchanged, so swaps reuse the cached visibility and are
+// re-scored in O(attendees) per musician whose contribution changes.
+// Scores are those of getScore() with volume optimization, i.e. every musician plays at volume 10 if its total impact
+// is positive and at volume 0 otherwise.
+class ScoringEngine {
+    enum class PendingType {
+        NONE,
+        MOVE,
+        SWAP
+    };
+
+    std::shared_ptr<Problem> problem;
+    ScoreType type;
+
+    std::size_t attendeeCount;
+    std::size_t musicianCount;
+
+    std::vector<Point> placements;
+
+    // Structure-of-arrays mirror of placements for the batched blocking kernel
+    std::vector<double> placementXs;
+    std::vector<double> placementYs;
+
+    // Per-(musician, attendee) state, stored musician-major at index musician * attendeeCount + attendee
+    std::vector<int> blockerCounts;
+    std::vector<char> pillarBlocked;
+    std::vector<double> impacts;
+
+    ClosenessCache closeness;
+    std::vector<double> closenessFactors;
+    std::vector<double> impactSums;
+    std::vector<double> weightedSums;
+    long long score = 0;
+
+    PendingType pendingType = PendingType::NONE;
+    std::size_t pendingMusician = 0;
+    std::size_t pendingOtherMusician = 0;
+    Point pendingPlacement;
+    long long pendingScore = 0;
+
+    std::vector<int> pendingBlockerCounts;
+    std::vector<char> pendingPillarBlocked;
+    std::vector<double> pendingImpacts;
+    std::vector<double> pendingOtherImpacts;
+
+    std::vector<double> pendingClosenessFactors;
+    std::vector<double> pendingImpactSums;
+    std::vector<double> pendingWeightedSums;
+
+public:
+    explicit ScoringEngine(const Solution &solution, ScoreType type = ScoreType::AUTO)
+            : problem(solution.problem),
+              type(type),
+              attendeeCount(solution.problem->attendees.size()),
+              musicianCount(solution.problem->musicians.size()),
+              placements(solution.placements) {
+        if (this->type == ScoreType::AUTO) {
+            this->type = problem->id <= 55 ? ScoreType::LIGHTNING : ScoreType::FULL;
+        }
+
+        placementXs.reserve(musicianCount);
+        placementYs.reserve(musicianCount);
+        for (const auto &placement : placements) {
+            placementXs.emplace_back(placement.x);
+            placementYs.emplace_back(placement.y);
+        }
+
+        blockerCounts.resize(musicianCount * attendeeCount);
+        pillarBlocked.resize(musicianCount * attendeeCount);
+        impacts.resize(musicianCount * attendeeCount);
+
+        pendingBlockerCounts.resize(attendeeCount);
+        pendingPillarBlocked.resize(attendeeCount);
+        pendingImpacts.resize(attendeeCount);
+        pendingOtherImpacts.resize(attendeeCount);
+
+        if (this->type == ScoreType::FULL) {
+            closeness = ClosenessCache(problem->musicians, placements);
+            closenessFactors = closeness.getFactors();
+        } else {
+            closenessFactors.resize(musicianCount, 1);
+        }
+
+        impactSums.resize(musicianCount);
+        weightedSums.resize(musicianCount);
+
+        pendingClosenessFactors.resize(musicianCount);
+        pendingImpactSums.resize(musicianCount);
+        pendingWeightedSums.resize(musicianCount);
+
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    VisibilitySweep sweep;
+                    for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                        Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+                        sweep.reset(position, placements, nullptr);
+                        for (std::size_t i = 0; i < musicianCount; i++) {
+                            blockerCounts[i * attendeeCount + attendeeIdx] = sweep.countBlockers(i);
+                        }
+                    }
+                }
+        );
+
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, musicianCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    for (std::size_t i = range.begin(); i != range.end(); i++) {
+                        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+                            std::size_t idx = i * attendeeCount + attendeeIdx;
+                            pillarBlocked[idx] = isPillarBlocked(placements[i], attendeeIdx);
+                            impacts[idx] = getImpact(i, placements[i], attendeeIdx);
+                        }
+
+                        sumMusician(&blockerCounts[i * attendeeCount],
+                                    &pillarBlocked[i * attendeeCount],
+                                    &impacts[i * attendeeCount],
+                                    closenessFactors[i],
+                                    impactSums[i],
+                                    weightedSums[i]);
+                    }
+                }
+        );
+
+        score = sumScore(impactSums, weightedSums);
+    }
+
+    // Returns roughly how many bytes an engine for the problem takes, which is dominated by its per-(musician, attendee)
+    // state
+    static std::size_t getMemoryEstimate(const Problem &problem) {
+        return problem.musicians.size() * problem.attendees.size() * (sizeof(int) + sizeof(char) + sizeof(double));
+    }
+
+    long long getScore() const {
+        return score;
+    }
+
+    const std::vector<Point> &getPlacements() const {
+        return placements;
+    }
+
+    // Returns the score the solution would have if the given musician was moved to the given placement
+    // The move is kept pending until commit() or rollback() is called, or until another move is tried
+    // The caller is responsible for ensuring the new placement is valid
+    long long tryMove(std::size_t musician, const Point &placement) {
+        pendingType = PendingType::MOVE;
+        pendingMusician = musician;
+        pendingPlacement = placement;
+
+        const Point &oldPlacement = placements[musician];
+        int instrument = problem->musicians[musician];
+
+        pendingClosenessFactors = closenessFactors;
+        if (type == ScoreType::FULL) {
+            closeness.getMovedFactors(musician, placement, pendingClosenessFactors);
+        }
+
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, musicianCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    std::vector<int> blockerDeltas(attendeeCount);
+
+                    for (std::size_t i = range.begin(); i != range.end(); i++) {
+                        if (i == musician) {
+                            continue;
+                        }
+
+                        getBlockingDeltas(placements[i].x, placements[i].y,
+                                          problem->attendeeXs.data(), problem->attendeeYs.data(), attendeeCount,
+                                          oldPlacement.x, oldPlacement.y, placement.x, placement.y, 5,
+                                          blockerDeltas.data());
+
+                        // Closeness factors only change for musicians playing the moved musician's instrument
+                        bool recompute = type == ScoreType::FULL && problem->musicians[i] == instrument;
+
+                        double impactSum = recompute ? 0 : impactSums[i];
+                        double weightedSum = recompute ? 0 : weightedSums[i];
+                        double closeness = pendingClosenessFactors[i];
+
+                        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+                            std::size_t idx = i * attendeeCount + attendeeIdx;
+                            if (impacts[idx] == 0 || pillarBlocked[idx]) {
+                                continue;
+                            }
+
+                            int oldCount = blockerCounts[idx];
+                            int newCount = oldCount + blockerDeltas[attendeeIdx];
+
+                            if (recompute) {
+                                if (newCount == 0) {
+                                    impactSum += impacts[idx];
+                                    weightedSum += std::ceil(10.0 * (closeness * impacts[idx]));
+                                }
+                            } else if (oldCount == 0 && newCount != 0) {
+                                impactSum -= impacts[idx];
+                                weightedSum -= std::ceil(10.0 * (closeness * impacts[idx]));
+                            } else if (oldCount != 0 && newCount == 0) {
+                                impactSum += impacts[idx];
+                                weightedSum += std::ceil(10.0 * (closeness * impacts[idx]));
+                            }
+                        }
+
+                        pendingImpactSums[i] = impactSum;
+                        pendingWeightedSums[i] = weightedSum;
+                    }
+                }
+        );
+
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                        pendingBlockerCounts[attendeeIdx] = getBlockerCount(musician, placement, attendeeIdx);
+                        pendingPillarBlocked[attendeeIdx] = isPillarBlocked(placement, attendeeIdx);
+                        pendingImpacts[attendeeIdx] = getImpact(musician, placement, attendeeIdx);
+                    }
+                }
+        );
+
+        sumMusician(pendingBlockerCounts.data(),
+                    pendingPillarBlocked.data(),
+                    pendingImpacts.data(),
+                    pendingClosenessFactors[musician],
+                    pendingImpactSums[musician],
+                    pendingWeightedSums[musician]);
+
+        pendingScore = sumScore(pendingImpactSums, pendingWeightedSums);
+        return pendingScore;
+    }
+
+    // Returns the score the solution would have if the placements of the given musicians were swapped
+    // The swap is kept pending until commit() or rollback() is called, or until another move is tried
+    long long trySwap(std::size_t musician1, std::size_t musician2) {
+        if (musician1 == musician2) {
+            pendingType = PendingType::NONE;
+            return score;
+        }
+
+        pendingType = PendingType::SWAP;
+        pendingMusician = musician1;
+        pendingOtherMusician = musician2;
+
+        pendingClosenessFactors = closenessFactors;
+        pendingImpactSums = impactSums;
+        pendingWeightedSums = weightedSums;
+
+        // Only the closeness factors of musicians playing one of the swapped instruments change
+        if (type == ScoreType::FULL) {
+            closeness.getSwappedFactors(musician1, musician2, pendingClosenessFactors);
+
+            for (int instrument : {problem->musicians[musician1], problem->musicians[musician2]}) {
+                for (std::size_t i : closeness.getGroup(instrument)) {
+                    if (i == musician1 || i == musician2 || pendingClosenessFactors[i] == closenessFactors[i]) {
+                        continue;
+                    }
+
+                    sumMusician(&blockerCounts[i * attendeeCount],
+                                &pillarBlocked[i * attendeeCount],
+                                &impacts[i * attendeeCount],
+                                pendingClosenessFactors[i],
+                                pendingImpactSums[i],
+                                pendingWeightedSums[i]);
+                }
+            }
+        }
+
+        // Each musician takes over the visibility of the other's placement, as the set of occupied points is unchanged
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                        pendingImpacts[attendeeIdx] = getImpact(musician1, placements[musician2], attendeeIdx);
+                        pendingOtherImpacts[attendeeIdx] = getImpact(musician2, placements[musician1], attendeeIdx);
+                    }
+                }
+        );
+
+        sumMusician(&blockerCounts[musician2 * attendeeCount],
+                    &pillarBlocked[musician2 * attendeeCount],
+                    pendingImpacts.data(),
+                    pendingClosenessFactors[musician1],
+                    pendingImpactSums[musician1],
+                    pendingWeightedSums[musician1]);
+
+        sumMusician(&blockerCounts[musician1 * attendeeCount],
+                    &pillarBlocked[musician1 * attendeeCount],
+                    pendingOtherImpacts.data(),
+                    pendingClosenessFactors[musician2],
+                    pendingImpactSums[musician2],
+                    pendingWeightedSums[musician2]);
+
+        pendingScore = sumScore(pendingImpactSums, pendingWeightedSums);
+        return pendingScore;
+    }
+
+    void commit() {
+        if (pendingType == PendingType::SWAP) {
+            commitSwap();
+            return;
+        }
+
+        if (pendingType != PendingType::MOVE) {
+            return;
+        }
+
+        std::size_t musician = pendingMusician;
+        const Point &oldPlacement = placements[musician];
+
+        isolatedParallelFor(
+                oneapi::tbb::blocked_range<std::size_t>(0, musicianCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    std::vector<int> blockerDeltas(attendeeCount);
+
+                    for (std::size_t i = range.begin(); i != range.end(); i++) {
+                        if (i == musician) {
+                            continue;
+                        }
+
+                        getBlockingDeltas(placements[i].x, placements[i].y,
+                                          problem->attendeeXs.data(), problem->attendeeYs.data(), attendeeCount,
+                                          oldPlacement.x, oldPlacement.y, pendingPlacement.x, pendingPlacement.y, 5,
+                                          blockerDeltas.data());
+
+                        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+                            blockerCounts[i * attendeeCount + attendeeIdx] += blockerDeltas[attendeeIdx];
+                        }
+                    }
+                }
+        );
+
+        std::copy(pendingBlockerCounts.begin(),
+                  pendingBlockerCounts.end(),
+                  blockerCounts.begin() + musician * attendeeCount);
+        std::copy(pendingPillarBlocked.begin(),
+                  pendingPillarBlocked.end(),
+                  pillarBlocked.begin() + musician * attendeeCount);
+        std::copy(pendingImpacts.begin(), pendingImpacts.end(), impacts.begin() + musician * attendeeCount);
+
+        placements[musician] = pendingPlacement;
+        placementXs[musician] = pendingPlacement.x;
+        placementYs[musician] = pendingPlacement.y;
+
+        if (type == ScoreType::FULL) {
+            closeness.move(musician, pendingPlacement);
+        }
+
+        std::swap(closenessFactors, pendingClosenessFactors);
+        std::swap(impactSums, pendingImpactSums);
+        std::swap(weightedSums, pendingWeightedSums);
+        score = pendingScore;
+
+        pendingType = PendingType::NONE;
+    }
+
+    void rollback() {
+        pendingType = PendingType::NONE;
+    }
+
+    Solution toSolution() const {
+        std::vector<double> volumes;
+        volumes.reserve(musicianCount);
+
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            volumes.emplace_back(impactSums[i] <= 0 ? 0 : 10);
+        }
+
+        return {problem, placements, volumes};
+    }
+
 private:
-    bool isBlocking(const Point &from, const Point &to, const Point &blockingCenter, double blockingRadius) const {
-        // Based on https://math.stackexchange.com/a/275537
+    // Engines are used from long-running tasks, like the chains of the annealing solvers, so their loops are isolated:
+    // a thread waiting for them only picks up their own subtasks, instead of starting another long-running task in the
+    // meantime and stalling this one until that task finishes
+    template<typename Range, typename Body>
+    static void isolatedParallelFor(const Range &range, const Body &body) {
+        oneapi::tbb::this_task_arena::isolate([&] {
+            oneapi::tbb::parallel_for(range, body);
+        });
+    }
 
-        double ax = from.x;
-        double ay = from.y;
+    void commitSwap() {
+        std::size_t musician1 = pendingMusician;
+        std::size_t musician2 = pendingOtherMusician;
 
-        double bx = to.x;
-        double by = to.y;
+        std::swap_ranges(blockerCounts.begin() + musician1 * attendeeCount,
+                         blockerCounts.begin() + (musician1 + 1) * attendeeCount,
+                         blockerCounts.begin() + musician2 * attendeeCount);
+        std::swap_ranges(pillarBlocked.begin() + musician1 * attendeeCount,
+                         pillarBlocked.begin() + (musician1 + 1) * attendeeCount,
+                         pillarBlocked.begin() + musician2 * attendeeCount);
 
-        double cx = blockingCenter.x;
-        double cy = blockingCenter.y;
-        double r = blockingRadius;
+        std::copy(pendingImpacts.begin(), pendingImpacts.end(), impacts.begin() + musician1 * attendeeCount);
+        std::copy(pendingOtherImpacts.begin(),
+                  pendingOtherImpacts.end(),
+                  impacts.begin() + musician2 * attendeeCount);
 
-        ax -= cx;
-        ay -= cy;
+        std::swap(placements[musician1], placements[musician2]);
+        std::swap(placementXs[musician1], placementXs[musician2]);
+        std::swap(placementYs[musician1], placementYs[musician2]);
 
-        bx -= cx;
-        by -= cy;
+        if (type == ScoreType::FULL) {
+            closeness.swap(musician1, musician2);
+        }
 
-        double a = (bx - ax) * (bx - ax) + (by - ay) * (by - ay);
-        double b = 2 * (ax * (bx - ax) + ay * (by - ay));
-        double c = ax * ax + ay * ay - r * r;
+        std::swap(closenessFactors, pendingClosenessFactors);
+        std::swap(impactSums, pendingImpactSums);
+        std::swap(weightedSums, pendingWeightedSums);
+        score = pendingScore;
+
+        pendingType = PendingType::NONE;
+    }
 
-        double disc = b * b - 4 * a * c;
-        if (disc <= 0) {
+    int getBlockerCount(std::size_t musician, const Point &placement, std::size_t attendeeIdx) const {
+        Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+        return static_cast<int>(countBlocking(placement.x, placement.y, position.x, position.y,
+                                              placementXs.data(), placementYs.data(), 0, musicianCount, musician, 5));
+    }
+
+    bool isPillarBlocked(const Point &placement, std::size_t attendeeIdx) const {
+        if (type != ScoreType::FULL) {
             return false;
         }
 
-        double discSqrt = std::sqrt(disc);
-        double t1 = (-b + discSqrt) / (2 * a);
-        double t2 = (-b - discSqrt) / (2 * a);
-        return (0 < t1 && t1 < 1) || (0 < t2 && t2 < 1);
+        return problem->isPillarBlocked(attendeeIdx, placement);
+    }
+
+    double getImpact(std::size_t musician, const Point &placement, std::size_t attendeeIdx) const {
+        double taste = problem->getMusicianTastes(musician)[attendeeIdx];
+        if (taste == 0) {
+            return 0;
+        }
+
+        Point position(problem->attendeeXs[attendeeIdx], problem->attendeeYs[attendeeIdx]);
+        double distance = position.distanceTo2(placement);
+        return std::ceil(1'000'000.0 * taste / distance);
+    }
+
+    void sumMusician(const int *counts,
+                     const char *blocked,
+                     const double *musicianImpacts,
+                     double closeness,
+                     double &impactSum,
+                     double &weightedSum) const {
+        impactSum = 0;
+        weightedSum = 0;
+
+        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+            if (counts[attendeeIdx] == 0 && !blocked[attendeeIdx]) {
+                impactSum += musicianImpacts[attendeeIdx];
+                weightedSum += std::ceil(10.0 * (closeness * musicianImpacts[attendeeIdx]));
+            }
+        }
+    }
+
+    long long sumScore(const std::vector<double> &musicianImpactSums,
+                       const std::vector<double> &musicianWeightedSums) const {
+        long long total = 0;
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            if (musicianImpactSums[i] > 0) {
+                total += static_cast<long long>(musicianWeightedSums[i]);
+            }
+        }
+
+        return total;
     }
 };
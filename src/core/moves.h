@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <random>
+
+#include <core/models.h>
+
+enum class MoveType {
+    SWAP,
+    JITTER,
+    TELEPORT
+};
+
+// A single local change to a solution
+// Swaps exchange the placements of musician1 and musician2, jitters and teleports move musician1 to placement
+struct Move {
+    MoveType type;
+    std::size_t musician1;
+    std::size_t musician2;
+    Point placement;
+};
+
+// Random moves shared by the local search solvers
+// Jitters move a musician by at most jitterSize in both directions, teleports move it to a random point on the stage
+class MoveSet {
+    std::uniform_int_distribution<std::size_t> indexDist;
+    std::uniform_real_distribution<double> xDist;
+    std::uniform_real_distribution<double> yDist;
+
+public:
+    double jitterSize;
+
+    explicit MoveSet(const Problem &problem, double jitterSize = 5)
+            : indexDist(0, problem.musicians.empty() ? 0 : problem.musicians.size() - 1),
+              xDist(problem.stage.bottomLeft.x, problem.stage.bottomLeft.x + problem.stage.width),
+              yDist(problem.stage.bottomLeft.y, problem.stage.bottomLeft.y + problem.stage.height),
+              jitterSize(jitterSize) {}
+
+    // Cycles through swaps, jitters and teleports
+    static MoveType getType(std::size_t iteration) {
+        switch (iteration % 3) {
+            case 0:
+                return MoveType::SWAP;
+            case 1:
+                return MoveType::JITTER;
+            default:
+                return MoveType::TELEPORT;
+        }
+    }
+
+    // Returns a random move of the given type, or nothing if the generated move would make the solution invalid
+    template<typename Rng>
+    std::optional<Move> generate(MoveType type, const PlacementGrid &grid, Rng &rng) {
+        std::size_t musician1 = indexDist(rng);
+
+        if (type == MoveType::SWAP) {
+            return Move{type, musician1, indexDist(rng), {}};
+        }
+
+        Point placement = grid.getPlacements()[musician1];
+        if (type == MoveType::JITTER) {
+            std::uniform_real_distribution<double> deltaDist(-jitterSize, jitterSize);
+            placement.x += deltaDist(rng);
+            placement.y += deltaDist(rng);
+        } else {
+            placement.x = xDist(rng);
+            placement.y = yDist(rng);
+        }
+
+        if (!grid.canMove(musician1, placement)) {
+            return std::nullopt;
+        }
+
+        return Move{type, musician1, musician1, placement};
+    }
+
+    // Returns a teleport of a random musician to the given placement, or nothing if the musician can't be moved there
+    template<typename Rng>
+    std::optional<Move> generateTeleport(const Point &placement, const PlacementGrid &grid, Rng &rng) {
+        std::size_t musician = indexDist(rng);
+        if (!grid.canMove(musician, placement)) {
+            return std::nullopt;
+        }
+
+        return Move{MoveType::TELEPORT, musician, musician, placement};
+    }
+};
+
+// Returns the score after applying the move, which is kept pending in the engine until it is committed or rolled back
+long long tryMove(ScoringEngine &engine, const Move &move) {
+    if (move.type == MoveType::SWAP) {
+        return engine.trySwap(move.musician1, move.musician2);
+    }
+
+    return engine.tryMove(move.musician1, move.placement);
+}
+
+// Commits the move pending in the engine and applies it to the grid
+void commitMove(ScoringEngine &engine, PlacementGrid &grid, const Move &move) {
+    engine.commit();
+
+    if (move.type == MoveType::SWAP) {
+        grid.swap(move.musician1, move.musician2);
+    } else {
+        grid.move(move.musician1, move.placement);
+    }
+}
+
+// Returns the mean score loss of the worsening moves among random swaps from the engine's current state
+// This is the natural scale of annealing temperatures, as it makes an average worsening move accepted with chance 1/e
+template<typename Rng>
+double sampleMeanLoss(ScoringEngine &engine, const PlacementGrid &grid, MoveSet &moves, Rng &rng, std::size_t samples) {
+    long long score = engine.getScore();
+
+    double totalLoss = 0;
+    std::size_t losses = 0;
+
+    for (std::size_t i = 0; i < samples; i++) {
+        auto move = moves.generate(MoveType::SWAP, grid, rng);
+
+        long long newScore = tryMove(engine, *move);
+        engine.rollback();
+
+        if (newScore < score) {
+            totalLoss += static_cast<double>(score - newScore);
+            losses++;
+        }
+    }
+
+    return losses == 0 ? 1 : totalLoss / static_cast<double>(losses);
+}
@@ -1,15 +1,20 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
-#include <fstream>
+#include <future>
 #include <iostream>
 #include <locale>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #define CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND 30
@@ -17,13 +22,13 @@
 #define CPPHTTPLIB_WRITE_TIMEOUT_SECOND 30
 
 #include <httplib.h>
+#include <oneapi/tbb.h>
 #include <rapidjson/document.h>
-#include <rapidjson/ostreamwrapper.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
 
 #include <core/config.h>
+#include <core/files.h>
 #include <core/models.h>
+#include <core/submissions.h>
 
 extern const unsigned char _binary_source_zip_start;
 extern const unsigned char _binary_source_zip_end;
@@ -38,6 +43,150 @@ struct ThousandsSeparator : std::numpunct<char> {
     }
 };
 
+// The closest directory containing the problems directory, starting from the working directory
+std::filesystem::path findProjectRoot() {
+    auto projectRoot = std::filesystem::current_path();
+    while (projectRoot.has_parent_path() && !std::filesystem::is_directory(projectRoot / "problems")) {
+        projectRoot = projectRoot.parent_path();
+    }
+
+    return projectRoot;
+}
+
+// Loads problems in the background in its own arena, so background tasks never end up in the arena of a caller that
+// may be gone by the time they would run
+// Tasks that didn't start yet are skipped when the prefetcher is destroyed
+class ProblemPrefetcher {
+    oneapi::tbb::task_arena arena;
+    oneapi::tbb::task_group tasks;
+
+public:
+    ProblemPrefetcher() = default;
+
+    ProblemPrefetcher(const ProblemPrefetcher &) = delete;
+
+    ProblemPrefetcher &operator=(const ProblemPrefetcher &) = delete;
+
+    ~ProblemPrefetcher() {
+        arena.execute([&] {
+            tasks.cancel();
+            tasks.wait();
+        });
+    }
+
+    template<typename Task>
+    void run(Task &&task) {
+        arena.execute([&] {
+            tasks.run(std::forward<Task>(task));
+        });
+    }
+};
+
+// Lazily loaded problem, as returned by Program::parseArgs()
+// take() returns the problem, loading it unless it was already loaded in the background, and starts loading the next
+// problem in the background, so it is ready by the time the caller is done with this one
+// The handle doesn't keep the problem alive after take(), so it is freed as soon as the caller drops it
+class ProblemHandle {
+    struct State {
+        int id;
+        std::filesystem::path file;
+
+        // Set by whichever of take() and the background task gets to load the problem first
+        std::atomic<bool> claimed{false};
+        std::promise<std::shared_ptr<Problem>> promise;
+        std::future<std::shared_ptr<Problem>> future = promise.get_future();
+
+        std::shared_ptr<State> next;
+    };
+
+    std::shared_ptr<State> state;
+    ProblemPrefetcher *prefetcher;
+
+public:
+    ProblemHandle(const std::filesystem::path &file, ProblemPrefetcher &prefetcher)
+            : state(std::make_shared<State>()), prefetcher(&prefetcher) {
+        state->id = getIdFromFile(file);
+        state->file = file;
+    }
+
+    int getId() const {
+        return state->id;
+    }
+
+    // Handles are meant to be taken once, taking a handle again loads its problem again
+    std::shared_ptr<Problem> take() {
+        if (state->next) {
+            prefetch(state->next);
+        }
+
+        if (!state->claimed.exchange(true)) {
+            // The background task won't load it anymore, so there is nothing to wait for
+            state->future = {};
+            return load(state->file);
+        }
+
+        if (state->future.valid()) {
+            return state->future.get();
+        }
+
+        return load(state->file);
+    }
+
+    // Makes sure the problem isn't loaded in the background anymore, and frees it if it already was, for problems that
+    // won't be taken (again)
+    void release() {
+        if (!state->claimed.exchange(true)) {
+            state->future = {};
+            return;
+        }
+
+        if (state->future.valid()) {
+            state->future.get();
+        }
+    }
+
+    // Starts loading the problem in the background, it is only loaded once
+    void prefetch() {
+        prefetch(state);
+    }
+
+    void setNext(const ProblemHandle &next) {
+        state->next = next.state;
+    }
+
+    // Loads the binary version of the problem written by convert if it is up-to-date, and the JSON file otherwise
+    static std::shared_ptr<Problem> load(const std::filesystem::path &jsonFile) {
+        auto binaryFile = jsonFile;
+        binaryFile.replace_extension(".bin");
+
+        std::error_code error;
+        auto binaryTime = std::filesystem::last_write_time(binaryFile, error);
+        if (!error && binaryTime >= std::filesystem::last_write_time(jsonFile)) {
+            auto problem = Problem::loadBinary(binaryFile);
+            if (problem) {
+                return problem;
+            }
+
+            std::cout << binaryFile.string() << " is not a valid binary problem, loading the JSON file" << std::endl;
+        }
+
+        return std::make_shared<Problem>(jsonFile);
+    }
+
+private:
+    void prefetch(const std::shared_ptr<State> &target) {
+        if (target->claimed.load()) {
+            return;
+        }
+
+        prefetcher->run([target] {
+            if (!target->claimed.exchange(true)) {
+                target->promise.set_value(load(target->file));
+            }
+        });
+    }
+};
+
 class Program {
     std::string target;
 
@@ -46,35 +195,98 @@ class Program {
     httplib::Client server;
     bool serverEnabled;
 
+    bool resumeEnabled = false;
+
     std::unordered_map<int, long long> localScores;
     std::unordered_map<int, long long> globalScores;
 
+    // Best score per problem that is queued or being submitted to the server
+    std::unordered_map<int, long long> submittedScores;
+
+    // Guards the scores, so multiple problems can be solved concurrently
+    std::mutex mutex;
+
+    // Guards the server client, which is only used by the solver threads
+    std::mutex serverMutex;
+
+    ProblemPrefetcher prefetcher;
+
+    // Solutions are written and submitted by a background worker with its own server client, so slow disks and slow
+    // or unreachable servers never stall the solvers
+    SubmissionQueue submissions;
+    httplib::Client submissionServer;
+    int maxSubmissionAttempts;
+    double submissionBackoff;
+
+    // Reused between submissions, so serializing solutions doesn't allocate once it is large enough
+    std::string solutionJson;
+    std::thread submissionWorker;
+
 public:
     explicit Program(const std::string &name)
-            : target(name), server(getEnv("SERVER_URL", "")), serverEnabled(!getEnv("SERVER_URL", "").empty()) {
+            : target(name),
+              server(getEnv("SERVER_URL", "")),
+              serverEnabled(!getEnv("SERVER_URL", "").empty()),
+              submissions(std::stoul(getEnv("SUBMISSION_QUEUE_SIZE", "256"))),
+              submissionServer(getEnv("SERVER_URL", "")),
+              maxSubmissionAttempts(std::stoi(getEnv("SUBMISSION_ATTEMPTS", "5"))),
+              submissionBackoff(std::stod(getEnv("SUBMISSION_BACKOFF", "1"))) {
         std::cout.imbue(std::locale(std::cout.getloc(), new ThousandsSeparator()));
 
-        projectRoot = std::filesystem::current_path();
-        while (projectRoot.has_parent_path() && !std::filesystem::is_directory(projectRoot / "problems")) {
-            projectRoot = projectRoot.parent_path();
+        projectRoot = findProjectRoot();
+
+        auto username = getEnv("SUBMITTER_USERNAME", "submitter");
+        auto password = getEnv("SUBMITTER_PASSWORD", "hunter2");
+        server.set_basic_auth(username, password);
+        submissionServer.set_basic_auth(username, password);
+
+        submissionWorker = std::thread([this] {
+            while (auto submission = submissions.pop()) {
+                process(*submission);
+            }
+        });
+    }
+
+    Program(const Program &) = delete;
+
+    Program &operator=(const Program &) = delete;
+
+    // Waits until the queued submissions are handled, failed submissions aren't retried anymore at this point
+    ~Program() {
+        auto remaining = submissions.size();
+        if (remaining > 0) {
+            std::cout << "Waiting for " << remaining << " queued submission" << (remaining != 1 ? "s" : "")
+                      << std::endl;
         }
 
-        server.set_basic_auth(getEnv("SUBMITTER_USERNAME", "submitter"), getEnv("SUBMITTER_PASSWORD", "hunter2"));
+        submissions.close();
+        submissionWorker.join();
     }
 
-    std::vector<std::shared_ptr<Problem>> parseArgs(int argc, char *argv[]) {
-        auto problemsRoot = projectRoot / "problems";
+    // Returns handles to the problems with the given ids, or to all problems if none are given
+    // Problems are loaded in order when they are taken, the first problem starts loading in the background right away
+    std::vector<ProblemHandle> parseArgs(int argc, char *argv[]) {
+        auto problemsRoot = getProblemsRoot();
 
-        std::vector<std::shared_ptr<Problem>> problems;
-        if (argc <= 1) {
+        std::vector<std::string> ids;
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg == "--resume") {
+                resumeEnabled = true;
+            } else {
+                ids.emplace_back(arg);
+            }
+        }
+
+        std::vector<ProblemHandle> problems;
+        if (ids.empty()) {
             for (const auto &entry : std::filesystem::directory_iterator(problemsRoot)) {
                 if (entry.path().extension() == ".json" && entry.is_regular_file()) {
-                    problems.emplace_back(std::make_shared<Problem>(entry.path()));
+                    problems.emplace_back(entry.path(), prefetcher);
                 }
             }
         } else {
-            for (int i = 1; i < argc; i++) {
-                std::string id(argv[i]);
+            for (const auto &id : ids) {
                 auto path = problemsRoot / (id + ".json");
 
                 if (!std::filesystem::is_regular_file(path)) {
@@ -85,14 +297,21 @@ public:
                     continue;
                 }
 
-                problems.emplace_back(std::make_shared<Problem>(path));
+                problems.emplace_back(path, prefetcher);
             }
         }
 
-        std::sort(problems.begin(), problems.end(),
-                  [](const std::shared_ptr<Problem> &a, const std::shared_ptr<Problem> &b) {
-                      return a->id < b->id;
-                  });
+        std::sort(problems.begin(), problems.end(), [](const ProblemHandle &a, const ProblemHandle &b) {
+            return a.getId() < b.getId();
+        });
+
+        for (std::size_t i = 0; i + 1 < problems.size(); i++) {
+            problems[i].setNext(problems[i + 1]);
+        }
+
+        if (!problems.empty()) {
+            problems[0].prefetch();
+        }
 
         if (problems.empty()) {
             std::cout << "No problems to solve" << std::endl;
@@ -106,7 +325,7 @@ public:
             std::cout << ':';
 
             for (const auto &problem : problems) {
-                std::cout << ' ' << problem->id;
+                std::cout << ' ' << problem.getId();
             }
 
             std::cout << std::endl;
@@ -120,10 +339,11 @@ public:
     }
 
     std::optional<Solution> getBestGlobalSolution(const std::shared_ptr<Problem> &problem) {
-        if (!serverEnabled || !globalScores.contains(problem->id)) {
+        if (!serverEnabled || !getBestGlobalScore(problem)) {
             return std::nullopt;
         }
 
+        std::lock_guard lock(serverMutex);
         auto response = server.Get("/problems/" + std::to_string(problem->id) + "/solution");
         if (!response || response->status >= 400) {
             return std::nullopt;
@@ -135,10 +355,22 @@ public:
         return Solution(problem, responseData);
     }
 
+    std::optional<long long> getBestGlobalScore(const std::shared_ptr<Problem> &problem) {
+        std::lock_guard lock(mutex);
+
+        if (!globalScores.contains(problem->id)) {
+            return std::nullopt;
+        }
+
+        return globalScores.at(problem->id);
+    }
+
     void submit(Solution &solution) {
         submit(solution, solution.getScore());
     }
 
+    // Queues the solution to be written and submitted in the background if it improves the best local or global score
+    // Only the improvement is reported right away, the result of submitting it is reported once the server responds
     void submit(const Solution &solution, long long score) {
         if (!solution.isValid()) {
             return;
@@ -148,75 +380,145 @@ public:
             return;
         }
 
-        auto localImprovement = isImprovement(localScores, solution.problem->id, score, "local");
+        int id = solution.problem->id;
+        std::lock_guard lock(mutex);
+
+        auto localImprovement = isImprovement(localScores, id, score, "local");
+        bool submitGlobal = serverEnabled
+                            && !isImprovement(globalScores, id, score, "global").empty()
+                            && !isImprovement(submittedScores, id, score, "global").empty();
+
+        if (localImprovement.empty() && !submitGlobal) {
+            return;
+        }
+
+        if (!submissions.push({solution, score, !localImprovement.empty(), submitGlobal})) {
+            std::cout << *solution.problem << "Submission queue is full, dropping solution with score " << score
+                      << std::endl;
+            return;
+        }
+
         if (!localImprovement.empty()) {
-            auto outputDirectory = projectRoot / "results" / target;
-            auto outputFile = outputDirectory / (std::to_string(solution.problem->id) + ".json");
+            std::cout << localImprovement << std::endl;
+            localScores[id] = score;
+        }
 
-            if (!std::filesystem::is_directory(outputDirectory)) {
-                std::filesystem::create_directories(outputDirectory);
+        if (submitGlobal) {
+            submittedScores[id] = score;
+        }
+    }
+
+    bool isServerEnabled() const {
+        return serverEnabled;
+    }
+
+    // Whether solvers should continue from their checkpoints, which is enabled by passing --resume
+    bool isResumeEnabled() const {
+        return resumeEnabled;
+    }
+
+    std::filesystem::path getProblemsRoot() const {
+        return projectRoot / "problems";
+    }
+
+    std::filesystem::path getCheckpointPath(const std::string &name) const {
+        return projectRoot / "checkpoints" / target / (name + ".bin");
+    }
+
+private:
+    // Runs on the submission worker
+    void process(Submission &submission) {
+        const auto &solution = submission.solution;
+        int id = solution.problem->id;
+
+        solutionJson.clear();
+        solution.appendJson(solutionJson);
+
+        if (submission.writeLocal) {
+            auto outputFile = projectRoot / "results" / target / (std::to_string(id) + ".json");
+            if (!writeFileAtomically(outputFile, solutionJson)) {
+                std::cout << "[Problem " << id << "] Something went wrong while writing " << outputFile.string()
+                          << std::endl;
             }
 
-            std::ofstream outputStream(outputFile);
-            rapidjson::OStreamWrapper outputStreamWrapper(outputStream);
-            rapidjson::Writer<rapidjson::OStreamWrapper> writer(outputStreamWrapper);
-            solution.toJson().Accept(writer);
+            submission.writeLocal = false;
+        }
 
-            std::cout << localImprovement << std::endl;
-            localScores[solution.problem->id] = score;
+        if (!submission.submitGlobal) {
+            return;
         }
 
-        if (!serverEnabled) {
+        // The archive is only copied here, on the worker, as the form data has to own its contents
+        std::string source(&_binary_source_zip_start, &_binary_source_zip_end);
+
+        httplib::MultipartFormDataItems formData = {
+                {"problemId",     std::to_string(id),               "",              ""},
+                {"score",         std::to_string(submission.score), "",              ""},
+                {"target",        target,                           "",              ""},
+                {"solutionFile",  solutionJson,                     "solution.json", "application/json"},
+                {"sourceArchive", source,                           "source.zip",    "application/zip"}
+        };
+
+        auto response = submissionServer.Post("/submit", formData);
+        if (response && response->status < 400) {
+            rapidjson::Document responseData;
+            responseData.Parse(response->body.c_str());
+
+            std::lock_guard lock(mutex);
+
+            bool newBest = responseData["new_best"].GetBool();
+            if (newBest) {
+                std::cout << isImprovement(globalScores, id, submission.score, "global") << std::endl;
+            }
+
+            globalScores[id] = responseData["best_score"].GetInt64();
             return;
         }
 
-        auto globalImprovement = isImprovement(globalScores, solution.problem->id, score, "global");
-        if (!globalImprovement.empty()) {
-            rapidjson::StringBuffer solutionBuffer;
-            rapidjson::Writer<rapidjson::StringBuffer> solutionWriter(solutionBuffer);
-            solution.toJson().Accept(solutionWriter);
+        std::stringstream error;
+        if (response) {
+            error << "Received HTTP " << response->status << " while submitting new global best";
+        } else {
+            error << "Something went wrong while submitting new global best: "
+                  << httplib::to_string(response.error());
+        }
 
-            std::string source(&_binary_source_zip_start, &_binary_source_zip_end);
+        // Client errors won't be fixed by trying again
+        submission.attempts++;
+        bool retryable = !response || response->status >= 500 || response->status == 429;
 
-            httplib::MultipartFormDataItems formData = {
-                    {"problemId",     std::to_string(solution.problem->id), "",              ""},
-                    {"score",         std::to_string(score),                "",              ""},
-                    {"target",        target,                               "",              ""},
-                    {"solutionFile",  solutionBuffer.GetString(),           "solution.json", "application/json"},
-                    {"sourceArchive", source,                               "source.zip",    "application/zip"}
-            };
+        long long score = submission.score;
+        if (retryable && submission.attempts < maxSubmissionAttempts) {
+            // Exponential backoff, capped at 64 times the initial delay
+            double delay = submissionBackoff * static_cast<double>(1 << std::min(submission.attempts - 1, 6));
+            int attempts = submission.attempts;
 
-            auto response = server.Post("/submit", formData);
-            if (response && response->status < 400) {
-                rapidjson::Document responseData;
-                responseData.Parse(response->body.c_str());
+            auto duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(delay));
 
-                bool newBest = responseData["new_best"].GetBool();
-                if (newBest) {
-                    std::cout << globalImprovement << std::endl;
-                }
+            if (submissions.retry(std::move(submission), duration)) {
+                std::cout << "[Problem " << id << "] " << error.str() << ", retrying in " << delay << " seconds ("
+                          << attempts << "/" << maxSubmissionAttempts << ")" << std::endl;
+                return;
+            }
 
-                globalScores[solution.problem->id] = responseData["best_score"].GetInt64();
-            } else if (response) {
-                std::cout << *solution.problem
-                          << "Received HTTP "
-                          << response->status
-                          << " while submitting new global best"
-                          << std::endl;
-            } else {
-                std::cout << *solution.problem
-                          << "Something went wrong while submitting new global best: "
-                          << httplib::to_string(response.error())
+            // A better solution took its place, which will be submitted instead
+            if (!submissions.isClosed()) {
+                std::cout << "[Problem " << id << "] " << error.str() << ", superseded by a better solution"
                           << std::endl;
+                return;
             }
         }
-    }
 
-    bool isServerEnabled() const {
-        return serverEnabled;
+        std::cout << "[Problem " << id << "] " << error.str() << ", giving up" << std::endl;
+
+        // Allows a later solution with the same score to be submitted again
+        std::lock_guard lock(mutex);
+        if (submittedScores.contains(id) && submittedScores.at(id) == score) {
+            submittedScores.erase(id);
+        }
     }
 
-private:
     void loadGlobalScores() {
         std::cout << "Loading global scores" << std::endl;
 
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/checkpoint.h>
+#include <core/models.h>
+#include <core/program.h>
+#include <core/timer.h>
+
+// Solves multiple problems concurrently, every problem running in its own task arena
+// Time is handed out in rounds, in which the problems whose score improved fastest relative to the best known score,
+// per thread-second they were given, get the most threads
+// Problems are loaded and jobs are created by createJob(problem) the first time a problem is scheduled, which returns a
+// pointer-like object to a job that supports:
+// - long long run(double seconds): works on the problem for about the given time, and returns the best score so far
+// - bool isFinished() const: whether more time can't improve the score
+// createJob returns a null pointer if the problem can't be solved
+// Problems and their jobs are released once they are finished, and problems that were finished before resuming are
+// never loaded
+// The scheduler state is checkpointed after every round, and continued from when the program runs with --resume
+class Scheduler {
+    // Problems that didn't get any threads for this many rounds are scheduled before all others
+    static constexpr std::size_t MAX_IDLE_ROUNDS = 5;
+
+    Program &program;
+
+    double totalTime;
+    double roundTime;
+    std::size_t threadCount;
+
+public:
+    Scheduler(Program &program, double totalTime, double roundTime)
+            : program(program),
+              totalTime(totalTime),
+              roundTime(roundTime),
+              threadCount(static_cast<std::size_t>(oneapi::tbb::info::default_concurrency())) {}
+
+    template<typename CreateJob>
+    void run(const std::vector<ProblemHandle> &problems, CreateJob createJob) {
+        using JobPointer = std::invoke_result_t<CreateJob &, const std::shared_ptr<Problem> &>;
+
+        struct ScheduledProblem {
+            ProblemHandle handle;
+            std::shared_ptr<Problem> problem;
+            JobPointer job{};
+
+            long long score = 0;
+            double priority = std::numeric_limits<double>::infinity();
+            std::size_t idleRounds = 0;
+            bool finished = false;
+        };
+
+        std::vector<ScheduledProblem> scheduled;
+        scheduled.reserve(problems.size());
+        for (const auto &handle : problems) {
+            scheduled.push_back({handle, nullptr});
+        }
+
+        std::cout << "Scheduling " << problems.size() << " problems on " << threadCount << " threads for "
+                  << totalTime << " seconds in rounds of " << roundTime << " seconds" << std::endl;
+
+        auto checkpointPath = program.getCheckpointPath("scheduler");
+
+        double elapsedSeconds = 0;
+        std::size_t round = 0;
+
+        if (program.isResumeEnabled()) {
+            auto checkpoint = CheckpointReader::load(checkpointPath);
+            if (checkpoint) {
+                elapsedSeconds = checkpoint->read<double>();
+                round = checkpoint->read<std::uint64_t>();
+
+                auto count = checkpoint->read<std::uint64_t>();
+                for (std::uint64_t i = 0; i < count && checkpoint->isValid(); i++) {
+                    auto id = checkpoint->read<int>();
+                    auto score = checkpoint->read<long long>();
+                    auto priority = checkpoint->read<double>();
+                    auto idleRounds = checkpoint->read<std::uint64_t>();
+                    auto finished = checkpoint->read<std::uint8_t>();
+
+                    for (auto &entry : scheduled) {
+                        if (entry.handle.getId() == id) {
+                            entry.score = score;
+                            entry.priority = priority;
+                            entry.idleRounds = idleRounds;
+                            entry.finished = finished != 0;
+                        }
+                    }
+                }
+            }
+
+            if (checkpoint && checkpoint->isValid()) {
+                for (auto &entry : scheduled) {
+                    if (entry.finished) {
+                        entry.handle.release();
+                    }
+                }
+
+                std::cout << "Resuming after " << round << " rounds and " << elapsedSeconds << " seconds" << std::endl;
+            } else {
+                std::cout << "No valid scheduler checkpoint found, starting from scratch" << std::endl;
+                elapsedSeconds = 0;
+                round = 0;
+            }
+        }
+
+        Timer timer(elapsedSeconds);
+
+        while (timer.elapsedSeconds() < totalTime) {
+            std::vector<ScheduledProblem *> candidates;
+            for (auto &entry : scheduled) {
+                if (!entry.finished) {
+                    candidates.emplace_back(&entry);
+                }
+            }
+
+            if (candidates.empty()) {
+                break;
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [](const ScheduledProblem *lhs, const ScheduledProblem *rhs) {
+                                 bool lhsStarved = lhs->idleRounds >= MAX_IDLE_ROUNDS;
+                                 bool rhsStarved = rhs->idleRounds >= MAX_IDLE_ROUNDS;
+                                 if (lhsStarved != rhsStarved) {
+                                     return lhsStarved;
+                                 }
+
+                                 return lhs->priority > rhs->priority;
+                             });
+
+            std::size_t selectedCount = std::min(candidates.size(), threadCount);
+            std::vector<ScheduledProblem *> selected(candidates.begin(),
+                                                     candidates.begin() + static_cast<std::ptrdiff_t>(selectedCount));
+
+            for (std::size_t i = selectedCount; i < candidates.size(); i++) {
+                candidates[i]->idleRounds++;
+            }
+
+            auto threads = allocateThreads(selected);
+            double seconds = std::min(roundTime, totalTime - timer.elapsedSeconds());
+
+            round++;
+            std::cout << "Round " << round << ":";
+            for (std::size_t i = 0; i < selectedCount; i++) {
+                std::cout << " " << selected[i]->handle.getId() << " (" << threads[i] << ")";
+            }
+            std::cout << std::endl;
+
+            // Arenas reserve a slot for the thread that enters them, so together they use exactly threadCount threads
+            std::vector<std::thread> runners;
+            runners.reserve(selectedCount);
+
+            for (std::size_t i = 0; i < selectedCount; i++) {
+                runners.emplace_back([&, i] {
+                    auto &entry = *selected[i];
+
+                    oneapi::tbb::task_arena arena(static_cast<int>(threads[i]));
+                    arena.execute([&] {
+                        if (!entry.job) {
+                            entry.problem = entry.handle.take();
+                            entry.job = createJob(entry.problem);
+
+                            if (!entry.job) {
+                                entry.problem.reset();
+                                entry.handle.release();
+                                entry.finished = true;
+                                return;
+                            }
+                        }
+
+                        long long score = entry.job->run(seconds);
+                        long long reference = std::max({program.getBestGlobalScore(entry.problem).value_or(0),
+                                                        score, 1LL});
+
+                        double gain = static_cast<double>(score - entry.score) / static_cast<double>(reference);
+                        entry.priority = gain / (seconds * static_cast<double>(threads[i]));
+
+                        entry.score = score;
+                        entry.idleRounds = 0;
+                        entry.finished = entry.job->isFinished();
+                        if (entry.finished) {
+                            std::cout << *entry.problem << "Finished, releasing the problem" << std::endl;
+
+                            entry.job = {};
+                            entry.problem.reset();
+                            entry.handle.release();
+                        }
+                    });
+                });
+            }
+
+            for (auto &runner : runners) {
+                runner.join();
+            }
+
+            CheckpointWriter checkpoint;
+            checkpoint.write(timer.elapsedSeconds());
+            checkpoint.write(static_cast<std::uint64_t>(round));
+            checkpoint.write(static_cast<std::uint64_t>(scheduled.size()));
+            for (const auto &entry : scheduled) {
+                checkpoint.write(entry.handle.getId());
+                checkpoint.write(entry.score);
+                checkpoint.write(entry.priority);
+                checkpoint.write(static_cast<std::uint64_t>(entry.idleRounds));
+                checkpoint.write(static_cast<std::uint8_t>(entry.finished));
+            }
+
+            checkpoint.save(checkpointPath);
+        }
+
+        std::cout << "Finished scheduling after " << round << " rounds in " << timer.elapsedSeconds() << " seconds"
+                  << std::endl;
+    }
+
+private:
+    // Gives every selected problem one thread, and divides the remaining threads proportionally to the priorities
+    // Problems that haven't run yet have an infinite priority, and share the remaining threads equally
+    template<typename ScheduledProblem>
+    std::vector<std::size_t> allocateThreads(const std::vector<ScheduledProblem *> &selected) const {
+        std::vector<std::size_t> threads(selected.size(), 1);
+        std::size_t remaining = threadCount - selected.size();
+
+        std::vector<double> weights(selected.size());
+        bool anyInfinite = std::any_of(selected.begin(), selected.end(), [](const ScheduledProblem *entry) {
+            return std::isinf(entry->priority);
+        });
+
+        for (std::size_t i = 0; i < selected.size(); i++) {
+            if (anyInfinite) {
+                weights[i] = std::isinf(selected[i]->priority) ? 1 : 0;
+            } else {
+                weights[i] = std::max(selected[i]->priority, 0.0);
+            }
+        }
+
+        double totalWeight = std::accumulate(weights.begin(), weights.end(), 0.0);
+        if (totalWeight == 0) {
+            std::fill(weights.begin(), weights.end(), 1);
+            totalWeight = static_cast<double>(weights.size());
+        }
+
+        std::size_t allocated = 0;
+        for (std::size_t i = 0; i < selected.size(); i++) {
+            auto extra = static_cast<std::size_t>(static_cast<double>(remaining) * weights[i] / totalWeight);
+            threads[i] += extra;
+            allocated += extra;
+        }
+
+        // Threads lost to rounding go to the problems with the highest priorities, which come first
+        for (std::size_t i = 0; allocated < remaining; i = (i + 1) % selected.size()) {
+            if (weights[i] > 0) {
+                threads[i]++;
+                allocated++;
+            }
+        }
+
+        return threads;
+    }
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include <oneapi/tbb.h>
+
+#include <core/models.h>
+
+// Best solution found by any of a number of concurrent workers, published and read without locks
+// Solutions are published as immutable snapshots by swapping an atomic pointer, and the epoch of the current snapshot
+// tells readers whether anything changed since they last looked
+// Snapshots are reclaimed with hazard pointers: every access claims a hazard entry and stores the snapshot it reads in
+// it, and a replaced snapshot is freed as soon as no entry holds it, so memory stays bounded by the number of
+// concurrent readers
+// Readers get copies, so snapshots are only accessed within the slot, and the best score is mirrored in a plain atomic,
+// so checking it doesn't touch the snapshot at all
+class BestSolutionSlot {
+public:
+    struct Snapshot {
+        Solution solution;
+        long long score;
+        std::uint64_t epoch;
+    };
+
+private:
+    struct HazardEntry {
+        std::atomic<bool> claimed{false};
+        std::atomic<const Snapshot *> snapshot{nullptr};
+    };
+
+    // Replaced snapshots that were still held by a hazard entry when they were replaced
+    struct RetiredSnapshot {
+        const Snapshot *snapshot;
+        RetiredSnapshot *next;
+    };
+
+    std::atomic<const Snapshot *> current{nullptr};
+    std::atomic<long long> bestScore{std::numeric_limits<long long>::min()};
+
+    // Every thread accesses the slot at most once at a time, so there is always a free entry, and claiming one only
+    // spins if more threads than expected access the slot at the same time
+    std::size_t hazardCount;
+    std::unique_ptr<HazardEntry[]> hazards;
+
+    std::atomic<RetiredSnapshot *> retired{nullptr};
+
+public:
+    BestSolutionSlot()
+            : hazardCount(2 * static_cast<std::size_t>(oneapi::tbb::info::default_concurrency()) + 8),
+              hazards(std::make_unique<HazardEntry[]>(hazardCount)) {}
+
+    BestSolutionSlot(const BestSolutionSlot &) = delete;
+
+    BestSolutionSlot &operator=(const BestSolutionSlot &) = delete;
+
+    ~BestSolutionSlot() {
+        delete current.load();
+
+        for (auto *node = retired.load(); node != nullptr;) {
+            auto *next = node->next;
+            delete node->snapshot;
+            delete node;
+            node = next;
+        }
+    }
+
+    // Returns a copy of the current snapshot if its epoch differs from the given one, so readers that pass the epoch
+    // they last saw only copy the solution when it changed
+    // Returns nothing if nothing was published yet
+    std::optional<Snapshot> get(std::uint64_t knownEpoch = 0) const {
+        auto &entry = claimHazard();
+        const auto *snapshot = protect(entry);
+
+        std::optional<Snapshot> copy;
+        if (snapshot != nullptr && snapshot->epoch != knownEpoch) {
+            copy = *snapshot;
+        }
+
+        releaseHazard(entry);
+        return copy;
+    }
+
+    // Returns the epoch of the current snapshot, or 0 if nothing was published yet
+    std::uint64_t getEpoch() const {
+        auto &entry = claimHazard();
+        const auto *snapshot = protect(entry);
+        std::uint64_t epoch = snapshot != nullptr ? snapshot->epoch : 0;
+        releaseHazard(entry);
+        return epoch;
+    }
+
+    long long getBestScore() const {
+        return bestScore.load(std::memory_order_acquire);
+    }
+
+    // Publishes the solution if it is better than the current best, returns the epoch of its snapshot if it was
+    // published and 0 otherwise
+    std::uint64_t publish(const Solution &solution, long long score) {
+        if (getBestScore() >= score) {
+            return 0;
+        }
+
+        auto snapshot = std::make_unique<Snapshot>(Snapshot{solution, score, 0});
+
+        auto &entry = claimHazard();
+        const auto *expected = protect(entry);
+
+        // Once published, the snapshot may be replaced and freed by other publishers at any time, so its epoch is
+        // remembered before
+        std::uint64_t epoch = 0;
+        while (expected == nullptr || expected->score < score) {
+            snapshot->epoch = expected != nullptr ? expected->epoch + 1 : 1;
+            if (current.compare_exchange_strong(expected, snapshot.get())) {
+                epoch = snapshot.release()->epoch;
+                break;
+            }
+
+            // The snapshot that replaced the expected one isn't protected yet
+            expected = protect(entry);
+        }
+
+        releaseHazard(entry);
+
+        if (epoch == 0) {
+            return 0;
+        }
+
+        // Only raised, as a concurrent better publish may already have stored its score
+        long long previousScore = bestScore.load(std::memory_order_relaxed);
+        while (previousScore < score && !bestScore.compare_exchange_weak(previousScore, score)) {}
+
+        if (expected != nullptr) {
+            retire(expected);
+        }
+
+        return epoch;
+    }
+
+private:
+    HazardEntry &claimHazard() const {
+        for (std::size_t i = 0;; i = (i + 1) % hazardCount) {
+            if (!hazards[i].claimed.load(std::memory_order_relaxed)
+                && !hazards[i].claimed.exchange(true, std::memory_order_acquire)) {
+                return hazards[i];
+            }
+        }
+    }
+
+    void releaseHazard(HazardEntry &entry) const {
+        entry.snapshot.store(nullptr, std::memory_order_release);
+        entry.claimed.store(false, std::memory_order_release);
+    }
+
+    // Stores the current snapshot in the entry and returns it, it isn't freed until the entry is released
+    // The snapshot may be replaced between loading it and storing it in the entry, so it is only protected once it is
+    // still current after storing it
+    const Snapshot *protect(HazardEntry &entry) const {
+        const auto *snapshot = current.load();
+        while (true) {
+            entry.snapshot.store(snapshot);
+
+            const auto *latest = current.load();
+            if (latest == snapshot) {
+                return snapshot;
+            }
+
+            snapshot = latest;
+        }
+    }
+
+    // Frees the replaced snapshot, and any previously replaced ones, unless a hazard entry still holds them
+    void retire(const Snapshot *snapshot) {
+        push(new RetiredSnapshot{snapshot, nullptr});
+
+        // Taking the whole list leaves every retired snapshot to exactly one caller
+        auto *node = retired.exchange(nullptr, std::memory_order_acquire);
+        while (node != nullptr) {
+            auto *next = node->next;
+            if (isProtected(node->snapshot)) {
+                push(node);
+            } else {
+                delete node->snapshot;
+                delete node;
+            }
+
+            node = next;
+        }
+    }
+
+    void push(RetiredSnapshot *node) {
+        node->next = retired.load(std::memory_order_relaxed);
+        while (!retired.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                              std::memory_order_relaxed)) {}
+    }
+
+    bool isProtected(const Snapshot *snapshot) const {
+        for (std::size_t i = 0; i < hazardCount; i++) {
+            if (hazards[i].snapshot.load() == snapshot) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include <core/models.h>
+
+// Solution waiting to be written to the results directory and/or submitted to the server
+struct Submission {
+    Solution solution;
+    long long score;
+
+    bool writeLocal;
+    bool submitGlobal;
+
+    // Number of failed attempts to submit the solution to the server
+    int attempts = 0;
+    std::chrono::steady_clock::time_point readyTime{};
+};
+
+// Bounded queue of submissions that are handled by a single background worker
+// Submissions are coalesced per problem: a better submission replaces the queued one of its problem, keeping its place
+// in the queue, so the queue never holds more than one submission per problem and older solutions are never sent once
+// a better one is known
+// Failed submissions are retried after a delay, while other submissions are handled in the meantime
+class SubmissionQueue {
+    std::size_t capacity;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::deque<int> order;
+    std::unordered_map<int, Submission> pending;
+    bool closed = false;
+
+public:
+    explicit SubmissionQueue(std::size_t capacity) : capacity(capacity) {}
+
+    // Never blocks, returns false if the submission was dropped because the queue is full or closed
+    bool push(Submission submission) {
+        {
+            std::lock_guard lock(mutex);
+            if (closed) {
+                return false;
+            }
+
+            int id = submission.solution.problem->id;
+            auto it = pending.find(id);
+            if (it != pending.end()) {
+                merge(it->second, std::move(submission));
+            } else if (order.size() < capacity) {
+                order.emplace_back(id);
+                pending.emplace(id, std::move(submission));
+            } else {
+                return false;
+            }
+        }
+
+        condition.notify_one();
+        return true;
+    }
+
+    // Queues a failed submission again after the given delay, unless a better submission for its problem arrived in
+    // the meantime or the queue is closed, in which case it is dropped and false is returned
+    bool retry(Submission submission, std::chrono::steady_clock::duration delay) {
+        {
+            std::lock_guard lock(mutex);
+            int id = submission.solution.problem->id;
+            if (closed || pending.contains(id)) {
+                return false;
+            }
+
+            submission.readyTime = std::chrono::steady_clock::now() + delay;
+            order.emplace_back(id);
+            pending.emplace(id, std::move(submission));
+        }
+
+        condition.notify_one();
+        return true;
+    }
+
+    // Blocks until a submission is ready, returns nothing once the queue is closed and empty
+    // Submissions that are waiting for a retry are handled right away once the queue is closed
+    std::optional<Submission> pop() {
+        std::unique_lock lock(mutex);
+
+        while (true) {
+            if (order.empty()) {
+                if (closed) {
+                    return std::nullopt;
+                }
+
+                condition.wait(lock);
+                continue;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            auto readyTime = std::chrono::steady_clock::time_point::max();
+
+            for (auto it = order.begin(); it != order.end(); it++) {
+                const auto &submission = pending.at(*it);
+                if (closed || submission.readyTime <= now) {
+                    auto node = pending.extract(*it);
+                    order.erase(it);
+                    return std::move(node.mapped());
+                }
+
+                readyTime = std::min(readyTime, submission.readyTime);
+            }
+
+            condition.wait_until(lock, readyTime);
+        }
+    }
+
+    // Lets the worker finish the queued submissions without waiting for retries, and rejects new ones
+    void close() {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+
+        condition.notify_all();
+    }
+
+    bool isClosed() {
+        std::lock_guard lock(mutex);
+        return closed;
+    }
+
+    std::size_t size() {
+        std::lock_guard lock(mutex);
+        return order.size();
+    }
+
+private:
+    // The queued submission is replaced if the new one is better, what the queued one still had to do is kept
+    static void merge(Submission &queued, Submission submission) {
+        if (submission.score <= queued.score) {
+            return;
+        }
+
+        submission.writeLocal = submission.writeLocal || queued.writeLocal;
+        submission.submitGlobal = submission.submitGlobal || queued.submitGlobal;
+        submission.attempts = queued.attempts;
+        submission.readyTime = queued.readyTime;
+
+        queued = std::move(submission);
+    }
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <oneapi/tbb.h>
+
+// Returns how long each of taskCount equally long tasks can run, so that running them all on the threads of the
+// current task arena takes about the given time
+// Tasks beyond the number of threads only start once others are done, so they get a share of the time instead of a
+// deadline that may already have passed by the time they start
+double getTaskTime(double seconds, std::size_t taskCount) {
+    auto threads = static_cast<double>(oneapi::tbb::this_task_arena::max_concurrency());
+    double waves = std::ceil(static_cast<double>(taskCount) / threads);
+    return seconds / std::max(waves, 1.0);
+}
+
+// Runs task(i) for every i in [0, taskCount), every i on its own TBB task
+// The default partitioner may run multiple long-running tasks one after another on the same thread, while other
+// threads are idle
+template<typename Task>
+void runLongTasks(std::size_t taskCount, const Task &task) {
+    oneapi::tbb::parallel_for(
+            oneapi::tbb::blocked_range<std::size_t>(0, taskCount, 1),
+            [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                for (std::size_t i = range.begin(); i != range.end(); i++) {
+                    task(i);
+                }
+            },
+            oneapi::tbb::simple_partitioner()
+    );
+}
@@ -6,8 +6,9 @@ class Timer {
     std::chrono::high_resolution_clock::time_point start;
 
 public:
-    Timer() {
-        reset();
+    // Timers can start with time already elapsed, to continue timing a resumed run
+    explicit Timer(double elapsedSeconds = 0) {
+        reset(elapsedSeconds);
     }
 
     double elapsedSeconds() const {
@@ -15,7 +16,9 @@ public:
         return std::chrono::duration_cast<std::chrono::duration<double>>(now - start).count();
     }
 
-    void reset() {
-        start = std::chrono::high_resolution_clock::now();
+    void reset(double elapsedSeconds = 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                std::chrono::duration<double>(elapsedSeconds));
+        start = std::chrono::high_resolution_clock::now() - elapsed;
     }
 };
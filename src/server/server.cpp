@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <httplib.h>
+#include <rapidjson/document.h>
+
+#include <core/config.h>
+#include <core/files.h>
+#include <core/models.h>
+#include <core/program.h>
+
+struct BestSubmission {
+    long long score;
+    std::string target;
+    std::string solutionJson;
+};
+
+std::optional<std::string> readFile(const std::filesystem::path &file) {
+    std::ifstream inputStream(file, std::ios::binary);
+    if (!inputStream) {
+        return std::nullopt;
+    }
+
+    return std::string(std::istreambuf_iterator<char>(inputStream), {});
+}
+
+template<typename T>
+std::optional<T> parseInteger(const std::string &value) {
+    T result{};
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (error != std::errc() || end != value.data() + value.size()) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+// Targets are CMake target names, which are written to the persisted submissions as they are
+bool isValidTarget(const std::string &target) {
+    return !target.empty() && std::all_of(target.begin(), target.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+    });
+}
+
+// Local stand-in for the submission server in server/main.py, implementing the endpoints Program uses, so solvers can
+// be run against a realistic server offline
+// Only the best submission of every problem is kept, in memory and in <data directory>/<problem id>/, and the score
+// of every submission is verified with the project's own scorer before it is accepted
+// Every submission is written to its own version directory, <problem id>/<score>/, and only becomes the persisted best
+// once the current file next to it, which holds the name of the version directory, is replaced to point to it, so a
+// crash never leaves a mix of two submissions behind
+class ScoreIndex {
+    std::filesystem::path problemsRoot;
+    std::filesystem::path dataRoot;
+
+    // Guards the best submissions and the files in the data directory
+    std::mutex mutex;
+    std::unordered_map<int, BestSubmission> best;
+
+    // Problems are loaded the first time they are submitted to and kept, so verifying scores doesn't re-parse them
+    std::mutex problemsMutex;
+    std::unordered_map<int, std::shared_ptr<Problem>> problems;
+
+public:
+    ScoreIndex(const std::filesystem::path &problemsRoot, const std::filesystem::path &dataRoot)
+            : problemsRoot(problemsRoot), dataRoot(dataRoot) {}
+
+    // Reads back the best submissions persisted by earlier runs
+    void load() {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(dataRoot, error)) {
+            auto id = parseInteger<int>(entry.path().filename().string());
+            if (!id) {
+                continue;
+            }
+
+            // Directories without a current file hold a submission directly, as written by older versions
+            auto directory = entry.path();
+            auto version = readFile(entry.path() / "current");
+            if (version) {
+                directory /= *version;
+            }
+
+            auto submissionData = readFile(directory / "submission.json");
+            auto solutionJson = readFile(directory / "solution.json");
+            if (!submissionData || !solutionJson) {
+                continue;
+            }
+
+            rapidjson::Document data;
+            data.Parse(submissionData->c_str());
+            if (data.HasParseError() || !data.IsObject() || !data.HasMember("score") || !data["score"].IsInt64()
+                || !data.HasMember("target") || !data["target"].IsString()) {
+                std::cout << "Skipping invalid submission in " << entry.path().string() << std::endl;
+                continue;
+            }
+
+            best[*id] = {data["score"].GetInt64(), data["target"].GetString(), std::move(*solutionJson)};
+        }
+
+        std::cout << "Loaded the best submissions of " << best.size() << " problems" << std::endl;
+    }
+
+    std::string getScoresJson() {
+        std::lock_guard lock(mutex);
+
+        std::string json = "{";
+        for (const auto &[id, submission] : best) {
+            if (json.size() > 1) {
+                json += ',';
+            }
+
+            json += "\"" + std::to_string(id) + "\":" + std::to_string(submission.score);
+        }
+
+        json += '}';
+        return json;
+    }
+
+    std::optional<std::string> getSolutionJson(int id) {
+        std::lock_guard lock(mutex);
+
+        if (!best.contains(id)) {
+            return std::nullopt;
+        }
+
+        return best.at(id).solutionJson;
+    }
+
+    // Returns the problem with the given id, or nullptr if it doesn't exist
+    std::shared_ptr<Problem> getProblem(int id) {
+        std::lock_guard lock(problemsMutex);
+
+        if (!problems.contains(id)) {
+            auto file = problemsRoot / (std::to_string(id) + ".json");
+            if (!std::filesystem::is_regular_file(file)) {
+                return nullptr;
+            }
+
+            problems[id] = ProblemHandle::load(file);
+        }
+
+        return problems.at(id);
+    }
+
+    // Stores the submission if it beats the best one, and returns whether it did and the best score afterwards
+    // Returns nothing if the submission beats the best one but couldn't be persisted, in which case the best one is kept
+    std::optional<std::pair<bool, long long>> submit(int id,
+                                                     long long score,
+                                                     const std::string &target,
+                                                     const std::string &solutionJson,
+                                                     const std::string &sourceArchive) {
+        std::lock_guard lock(mutex);
+
+        if (best.contains(id) && best.at(id).score >= score) {
+            return std::pair(false, best.at(id).score);
+        }
+
+        auto directory = dataRoot / std::to_string(id);
+        if (!persist(directory, score, target, solutionJson, sourceArchive)) {
+            std::cout << "[Problem " << id << "] Something went wrong while persisting the submission to "
+                      << directory.string() << std::endl;
+            return std::nullopt;
+        }
+
+        if (best.contains(id)) {
+            std::cout << "[Problem " << id << "] New best score by " << target << ": " << best.at(id).score << " -> "
+                      << score << std::endl;
+        } else {
+            std::cout << "[Problem " << id << "] New best score by " << target << ": " << score << std::endl;
+        }
+
+        best[id] = {score, target, solutionJson};
+        return std::pair(true, score);
+    }
+
+private:
+    // Writes the submission to a new version directory and points the current file to it, then removes all other
+    // versions
+    // A better submission always has a higher score, so the version directory of the current one is never overwritten
+    static bool persist(const std::filesystem::path &directory,
+                        long long score,
+                        const std::string &target,
+                        const std::string &solutionJson,
+                        const std::string &sourceArchive) {
+        auto version = std::to_string(score);
+        auto versionDirectory = directory / version;
+        auto submissionData = "{\"score\":" + std::to_string(score) + ",\"target\":\"" + target + "\"}";
+
+        // Left behind by an earlier attempt that failed before it was made current
+        std::error_code error;
+        std::filesystem::remove_all(versionDirectory, error);
+        std::filesystem::create_directories(versionDirectory, error);
+
+        bool written = !error
+                       && writeNewFile(versionDirectory / "solution.json", solutionJson)
+                       && writeNewFile(versionDirectory / "source.zip", sourceArchive)
+                       && writeNewFile(versionDirectory / "submission.json", submissionData)
+                       && syncDirectory(versionDirectory)
+                       && syncDirectory(directory)
+                       && writeFileAtomically(directory / "current", version);
+
+        if (!written) {
+            std::filesystem::remove_all(versionDirectory, error);
+            return false;
+        }
+
+        std::vector<std::filesystem::path> outdated;
+        for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+            auto name = entry.path().filename();
+            if (name != version && name != "current") {
+                outdated.emplace_back(entry.path());
+            }
+        }
+
+        for (const auto &path : outdated) {
+            std::filesystem::remove_all(path, error);
+        }
+
+        return true;
+    }
+};
+
+bool isValidSolutionJson(const rapidjson::Document &data) {
+    if (!data.IsObject() || !data.HasMember("placements") || !data["placements"].IsArray()) {
+        return false;
+    }
+
+    for (const auto &placement : data["placements"].GetArray()) {
+        if (!placement.IsObject() || !placement.HasMember("x") || !placement["x"].IsNumber()
+            || !placement.HasMember("y") || !placement["y"].IsNumber()) {
+            return false;
+        }
+    }
+
+    if (data.HasMember("volumes")) {
+        if (!data["volumes"].IsArray()) {
+            return false;
+        }
+
+        for (const auto &volume : data["volumes"].GetArray()) {
+            if (!volume.IsNumber()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void setError(httplib::Response &response, int status, const std::string &message) {
+    response.status = status;
+    response.set_content("{\"error\":\"" + message + "\"}", "application/json");
+}
+
+int main() {
+    std::cout.imbue(std::locale(std::cout.getloc(), new ThousandsSeparator()));
+
+    auto projectRoot = findProjectRoot();
+
+    std::string host = getEnv("SERVER_HOST", "127.0.0.1");
+    int port = std::stoi(getEnv("SERVER_PORT", "5000"));
+    std::filesystem::path dataRoot = getEnv("DATA_DIRECTORY", (projectRoot / "server" / "instance" / "local").string());
+
+    auto authorization = httplib::make_basic_authentication_header(getEnv("SUBMITTER_USERNAME", "submitter"),
+                                                                   getEnv("SUBMITTER_PASSWORD", "hunter2"),
+                                                                   false).second;
+
+    ScoreIndex index(projectRoot / "problems", dataRoot);
+    index.load();
+
+    httplib::Server server;
+    server.set_payload_max_length(64 * 1024 * 1024);
+
+    server.set_pre_routing_handler([&](const httplib::Request &request, httplib::Response &response) {
+        if (request.get_header_value("Authorization") == authorization) {
+            return httplib::Server::HandlerResponse::Unhandled;
+        }
+
+        response.set_header("WWW-Authenticate", "Basic realm=\"score-server\"");
+        setError(response, 401, "Unauthorized");
+        return httplib::Server::HandlerResponse::Handled;
+    });
+
+    server.Get("/scores", [&](const httplib::Request &, httplib::Response &response) {
+        response.set_content(index.getScoresJson(), "application/json");
+    });
+
+    server.Get(R"(/problems/(\d+)/solution)", [&](const httplib::Request &request, httplib::Response &response) {
+        auto id = parseInteger<int>(request.matches[1]);
+        auto solutionJson = id ? index.getSolutionJson(*id) : std::nullopt;
+        if (!solutionJson) {
+            setError(response, 404, "No solution found");
+            return;
+        }
+
+        response.set_content(*solutionJson, "application/json");
+    });
+
+    server.Post("/submit", [&](const httplib::Request &request, httplib::Response &response) {
+        for (const auto *field : {"problemId", "score", "target", "solutionFile", "sourceArchive"}) {
+            if (!request.has_file(field)) {
+                setError(response, 400, std::string("Missing ") + field);
+                return;
+            }
+        }
+
+        auto id = parseInteger<int>(request.get_file_value("problemId").content);
+        auto claimedScore = parseInteger<long long>(request.get_file_value("score").content);
+        if (!id || !claimedScore) {
+            setError(response, 400, "Invalid problem id or score");
+            return;
+        }
+
+        auto target = request.get_file_value("target").content;
+        if (!isValidTarget(target)) {
+            setError(response, 400, "Invalid target");
+            return;
+        }
+
+        auto solutionJson = request.get_file_value("solutionFile").content;
+
+        auto problem = index.getProblem(*id);
+        if (!problem) {
+            setError(response, 404, "Unknown problem");
+            return;
+        }
+
+        rapidjson::Document solutionData;
+        solutionData.Parse(solutionJson.c_str());
+        if (solutionData.HasParseError() || !isValidSolutionJson(solutionData)) {
+            setError(response, 400, "Invalid solution file");
+            return;
+        }
+
+        Solution solution(problem, solutionData);
+        if (!solution.isValid()) {
+            setError(response, 422, "Invalid solution");
+            return;
+        }
+
+        // The volumes are scored as submitted, like the official scorer does, and the verified score is the one that
+        // counts
+        long long score = solution.getScore(ScoreType::AUTO, false);
+        if (score != *claimedScore) {
+            std::cout << *problem << "Submission by " << target << " claimed " << *claimedScore << " but scores "
+                      << score << std::endl;
+        }
+
+        auto result = index.submit(*id, score, target, solutionJson, request.get_file_value("sourceArchive").content);
+        if (!result) {
+            setError(response, 500, "Could not persist the submission");
+            return;
+        }
+
+        auto [newBest, bestScore] = *result;
+        response.set_content("{\"new_best\":" + std::string(newBest ? "true" : "false") + ",\"best_score\":"
+                             + std::to_string(bestScore) + "}", "application/json");
+    });
+
+    std::cout << "Listening on " << host << ":" << port << ", storing submissions in " << dataRoot.string()
+              << std::endl;
+
+    if (!server.listen(host, port)) {
+        std::cout << "Could not listen on " << host << ":" << port << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/config.h>
+#include <core/generators.h>
+#include <core/models.h>
+#include <core/moves.h>
+#include <core/program.h>
+#include <core/tasks.h>
+#include <core/timer.h>
+
+// Temperature schedule of all chains, going from startTemperature to endTemperature over the optimization time
+struct Schedule {
+    bool linear;
+    double startTemperature;
+    double endTemperature;
+
+    double getTemperature(double progress) const {
+        progress = std::clamp(progress, 0.0, 1.0);
+
+        if (linear) {
+            return startTemperature + (endTemperature - startTemperature) * progress;
+        }
+
+        return startTemperature * std::pow(endTemperature / startTemperature, progress);
+    }
+};
+
+// A single annealing chain, which only ever runs on one thread at a time
+struct Chain {
+    // Jitter sizes are adapted to keep the acceptance rate of jitters close to this rate
+    static constexpr double TARGET_ACCEPTANCE_RATE = 0.3;
+    static constexpr std::size_t ADAPTATION_INTERVAL = 200;
+
+    ScoringEngine engine;
+    PlacementGrid grid;
+    MoveSet moves;
+    std::mt19937 rng;
+
+    long long score;
+
+    Solution bestSolution;
+    long long bestScore;
+
+    std::size_t jitterAttempts = 0;
+    std::size_t jitterAccepts = 0;
+
+    std::size_t iterations = 0;
+
+    Chain(const Solution &solution, unsigned int seed)
+            : engine(solution),
+              grid(solution.problem->stage, solution.placements),
+              moves(*solution.problem),
+              rng(seed),
+              score(engine.getScore()),
+              bestSolution(engine.toSolution()),
+              bestScore(score) {}
+
+    // The score is taken from the engine, as the score of the solution may differ from it in the last bits of the
+    // incrementally updated closeness factors
+    void reset(const Solution &solution) {
+        engine = ScoringEngine(solution);
+        grid = PlacementGrid(solution.problem->stage, solution.placements);
+        score = engine.getScore();
+    }
+
+    // Runs iterations for the given time, with the temperature following the schedule over totalTime
+    // The chain's own time is stretched over the round that starts at roundElapsed and takes roundTime, so all chains of
+    // a round go through the same temperatures, even those that only run in a later wave of the round
+    void run(const Schedule &schedule, double roundElapsed, double roundTime, double seconds, double totalTime) {
+        const auto &problem = bestSolution.problem;
+
+        std::uniform_real_distribution<double> unitDist(0, 1);
+
+        double maxJitterSize = std::max(problem->stage.width, problem->stage.height);
+
+        double stretch = seconds > 0 ? roundTime / seconds : 1;
+
+        Timer runTimer;
+        double elapsed = roundElapsed;
+        while (runTimer.elapsedSeconds() < seconds) {
+            double temperature = schedule.getTemperature(elapsed / totalTime);
+
+            // Reading the clock is relatively expensive, so it is only done every few iterations
+            for (int batch = 0; batch < 16; batch++) {
+                iterations++;
+
+                auto type = MoveSet::getType(iterations);
+                auto move = moves.generate(type, grid, rng);
+
+                if (!move) {
+                    if (type == MoveType::JITTER) {
+                        adaptJitterSize(false, maxJitterSize);
+                    }
+
+                    continue;
+                }
+
+                long long newScore = tryMove(engine, *move);
+
+                long long delta = newScore - score;
+                bool accepted = delta >= 0 || unitDist(rng) < std::exp(static_cast<double>(delta) / temperature);
+
+                if (type == MoveType::JITTER) {
+                    adaptJitterSize(accepted, maxJitterSize);
+                }
+
+                if (!accepted) {
+                    engine.rollback();
+                    continue;
+                }
+
+                commitMove(engine, grid, *move);
+                score = newScore;
+
+                if (score > bestScore) {
+                    bestSolution = engine.toSolution();
+                    bestScore = score;
+                }
+            }
+
+            elapsed = roundElapsed + runTimer.elapsedSeconds() * stretch;
+        }
+    }
+
+private:
+    void adaptJitterSize(bool accepted, double maxJitterSize) {
+        jitterAttempts++;
+        if (accepted) {
+            jitterAccepts++;
+        }
+
+        if (jitterAttempts < ADAPTATION_INTERVAL) {
+            return;
+        }
+
+        double acceptanceRate = static_cast<double>(jitterAccepts) / static_cast<double>(jitterAttempts);
+        moves.jitterSize *= acceptanceRate > TARGET_ACCEPTANCE_RATE ? 1.2 : 0.8;
+        moves.jitterSize = std::clamp(moves.jitterSize, 0.1, maxJitterSize);
+
+        jitterAttempts = 0;
+        jitterAccepts = 0;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    Program program("anneal");
+    auto problems = program.parseArgs(argc, argv);
+
+    std::random_device randomDevice;
+
+    double annealTime = std::stod(getEnv("ANNEAL_TIME", "180"));
+    double exchangeInterval = std::stod(getEnv("ANNEAL_EXCHANGE_INTERVAL", "10"));
+
+    // Temperatures default to values calibrated on the score losses of random moves from the initial state
+    std::string startTemperatureValue = getEnv("ANNEAL_START_TEMPERATURE", "");
+    std::string endTemperatureValue = getEnv("ANNEAL_END_TEMPERATURE", "");
+    bool linearSchedule = getEnv("ANNEAL_SCHEDULE", "geometric") == "linear";
+
+    // Every chain owns a scoring engine, which holds state for every (musician, attendee) pair, so by default there
+    // is a chain per thread, but only as many as fit in the memory budget
+    std::string chainCountValue = getEnv("ANNEAL_CHAINS", "");
+    double memoryBudget = std::stod(getEnv("ANNEAL_MEMORY_BUDGET_MB", "2048")) * 1024 * 1024;
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        Solution initialSolution(problem, {}, {});
+        long long initialScore = 0;
+
+        if (program.isServerEnabled()) {
+            std::cout << *problem << "Retrieving best global solution" << std::endl;
+            auto bestGlobalSolution = program.getBestGlobalSolution(problem);
+            if (bestGlobalSolution) {
+                initialSolution = *bestGlobalSolution;
+                initialScore = bestGlobalSolution->getScore();
+                program.submit(initialSolution, initialScore);
+            } else {
+                std::cout << *problem << "No best global solution found" << std::endl;
+            }
+        }
+
+        if (initialScore == 0) {
+            std::cout << *problem << "Generating initial random solution" << std::endl;
+
+            auto randomSolution = generateRandomSolution(problem);
+            if (!randomSolution) {
+                std::cout << *problem << "Stage can't fit all " << problem->musicians.size() << " musicians"
+                          << std::endl;
+                continue;
+            }
+
+            initialSolution = *randomSolution;
+            initialScore = initialSolution.getScore();
+            program.submit(initialSolution, initialScore);
+        }
+
+        std::size_t chainCount;
+        if (chainCountValue.empty()) {
+            auto engineSize = static_cast<double>(std::max<std::size_t>(ScoringEngine::getMemoryEstimate(*problem), 1));
+            chainCount = std::min(static_cast<std::size_t>(oneapi::tbb::this_task_arena::max_concurrency()),
+                                  static_cast<std::size_t>(memoryBudget / engineSize));
+        } else {
+            chainCount = static_cast<std::size_t>(std::stoul(chainCountValue));
+        }
+
+        chainCount = std::max<std::size_t>(chainCount, 1);
+
+        std::vector<Chain> chains;
+        chains.reserve(chainCount);
+        for (std::size_t i = 0; i < chainCount; i++) {
+            chains.emplace_back(initialSolution, randomDevice());
+        }
+
+        Schedule schedule{linearSchedule, 0, 0};
+        if (startTemperatureValue.empty()) {
+            auto &chain = chains[0];
+            schedule.startTemperature = sampleMeanLoss(chain.engine, chain.grid, chain.moves, chain.rng, 200);
+        } else {
+            schedule.startTemperature = std::stod(startTemperatureValue);
+        }
+
+        if (endTemperatureValue.empty()) {
+            schedule.endTemperature = schedule.startTemperature * 1e-3;
+        } else {
+            schedule.endTemperature = std::stod(endTemperatureValue);
+        }
+
+        std::cout << *problem << "Annealing " << chainCount << " chains for " << annealTime
+                  << " seconds with temperature " << schedule.startTemperature << " -> " << schedule.endTemperature
+                  << ", exchanging states every " << exchangeInterval << " seconds" << std::endl;
+
+        Solution bestSolution = initialSolution;
+        long long bestScore = initialScore;
+        long long submittedScore = initialScore;
+
+        Timer timer;
+        while (timer.elapsedSeconds() < annealTime) {
+            double roundElapsed = timer.elapsedSeconds();
+            double roundTime = std::min(exchangeInterval, annealTime - roundElapsed);
+            double chainTime = getTaskTime(roundTime, chains.size());
+
+            runLongTasks(chains.size(), [&](std::size_t i) {
+                chains[i].run(schedule, roundElapsed, roundTime, chainTime, annealTime);
+            });
+
+            for (const auto &chain : chains) {
+                if (chain.bestScore > bestScore) {
+                    bestSolution = chain.bestSolution;
+                    bestScore = chain.bestScore;
+                }
+            }
+
+            // The engine updates closeness factors incrementally, so the submitted score is computed from scratch
+            if (bestScore > submittedScore) {
+                Solution submittedSolution = bestSolution;
+                program.submit(submittedSolution);
+                submittedScore = bestScore;
+            }
+
+            // The worse half of the chains continues from the best state found so far, the better half keeps exploring
+            std::vector<std::size_t> order(chains.size());
+            for (std::size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+
+            std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+                return chains[lhs].score > chains[rhs].score;
+            });
+
+            for (std::size_t i = (order.size() + 1) / 2; i < order.size(); i++) {
+                chains[order[i]].reset(bestSolution);
+            }
+        }
+
+        std::size_t iterations = 0;
+        for (const auto &chain : chains) {
+            iterations += chain.iterations;
+        }
+
+        program.submit(bestSolution);
+        std::cout << *problem << "Ran " << iterations << " annealing iterations" << std::endl;
+    }
+
+    return 0;
+}
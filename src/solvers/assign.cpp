@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/assignment.h>
+#include <core/candidates.h>
+#include <core/models.h>
+#include <core/program.h>
+#include <core/timer.h>
+
+// Assigns every musician to one of the points, maximizing the total value of the assigned (instrument, point) pairs
+// Musicians with a negative value are muted by the volume optimization, so values are capped at 0 from below
+std::vector<Point> assignMusicians(const Problem &problem,
+                                   const std::vector<Point> &points,
+                                   const std::vector<double> &values) {
+    std::size_t musicianCount = problem.musicians.size();
+    std::size_t pointCount = points.size();
+
+    std::vector<double> costs(musicianCount * pointCount);
+    oneapi::tbb::parallel_for(std::size_t(0), musicianCount, [&](std::size_t i) {
+        const double *instrumentValues = values.data() + problem.musicians[i] * pointCount;
+        for (std::size_t p = 0; p < pointCount; p++) {
+            costs[i * pointCount + p] = -std::max(instrumentValues[p], 0.0);
+        }
+    });
+
+    auto assignment = solveAssignment(costs, musicianCount, pointCount);
+
+    std::vector<Point> placements;
+    placements.reserve(musicianCount);
+    for (std::size_t i = 0; i < musicianCount; i++) {
+        placements.emplace_back(points[assignment[i]]);
+    }
+
+    return placements;
+}
+
+int main(int argc, char *argv[]) {
+    Program program("assign");
+    auto problems = program.parseArgs(argc, argv);
+
+    // Number of candidate points per musician that are passed to the assignment, as a multiple of the musician count
+    double candidateFactor = 2;
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        std::size_t musicianCount = problem->musicians.size();
+        if (musicianCount == 0) {
+            continue;
+        }
+
+        Timer timer;
+
+        auto points = generateCandidatePoints(*problem);
+        if (points.size() < musicianCount) {
+            std::cout << *problem << "Stage can't fit all " << musicianCount << " musicians" << std::endl;
+            continue;
+        }
+
+        std::cout << *problem << "Generated " << points.size() << " candidate points" << std::endl;
+
+        // Visibility between musicians depends on which points are chosen, so the initial assignment only takes
+        // pillars into account and is restricted to the most valuable points for any instrument that is played
+        auto values = getPointValues(*problem, points, false);
+
+        std::vector<char> isPlayed(problem->instrumentCount);
+        for (int instrument : problem->musicians) {
+            isPlayed[instrument] = 1;
+        }
+
+        std::vector<double> bestValues(points.size());
+        for (std::size_t instrument = 0; instrument < problem->instrumentCount; instrument++) {
+            if (!isPlayed[instrument]) {
+                continue;
+            }
+
+            for (std::size_t p = 0; p < points.size(); p++) {
+                bestValues[p] = std::max(bestValues[p], values[instrument * points.size() + p]);
+            }
+        }
+
+        std::vector<std::size_t> order(points.size());
+        for (std::size_t p = 0; p < order.size(); p++) {
+            order[p] = p;
+        }
+
+        auto candidateCount = std::min(points.size(),
+                                       static_cast<std::size_t>(candidateFactor * static_cast<double>(musicianCount)));
+        candidateCount = std::max(candidateCount, musicianCount);
+
+        std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(candidateCount), order.end(),
+                          [&](std::size_t lhs, std::size_t rhs) {
+                              return bestValues[lhs] > bestValues[rhs];
+                          });
+
+        std::vector<Point> candidates;
+        std::vector<double> candidateValues(problem->instrumentCount * candidateCount);
+
+        candidates.reserve(candidateCount);
+        for (std::size_t k = 0; k < candidateCount; k++) {
+            candidates.emplace_back(points[order[k]]);
+
+            for (std::size_t instrument = 0; instrument < problem->instrumentCount; instrument++) {
+                candidateValues[instrument * candidateCount + k] = values[instrument * points.size() + order[k]];
+            }
+        }
+
+        Solution bestSolution(problem, assignMusicians(*problem, candidates, candidateValues));
+        long long bestScore = bestSolution.getScore();
+
+        std::cout << *problem << "Assigned " << musicianCount << " musicians to " << candidateCount
+                  << " candidate points, score " << bestScore << std::endl;
+
+        // With the chosen points fixed, visibility between musicians is fixed too, so re-assigning the musicians to
+        // those points with exact visibility gives the optimal assignment to them, apart from the closeness factors
+        auto chosenPoints = bestSolution.placements;
+        auto chosenValues = getPointValues(*problem, chosenPoints, true);
+
+        Solution refinedSolution(problem, assignMusicians(*problem, chosenPoints, chosenValues));
+        long long refinedScore = refinedSolution.getScore();
+
+        std::cout << *problem << "Re-assigned musicians with exact visibility, score " << refinedScore << std::endl;
+
+        if (refinedScore > bestScore) {
+            bestSolution = refinedSolution;
+            bestScore = refinedScore;
+        }
+
+        program.submit(bestSolution, bestScore);
+        std::cout << *problem << "Finished in " << timer.elapsedSeconds() << " seconds" << std::endl;
+    }
+
+    return 0;
+}
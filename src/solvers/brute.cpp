@@ -1,209 +1,367 @@
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
-#include <limits>
 #include <memory>
+#include <optional>
 #include <random>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include <oneapi/tbb.h>
+
+#include <core/checkpoint.h>
+#include <core/config.h>
+#include <core/generators.h>
 #include <core/models.h>
+#include <core/moves.h>
 #include <core/program.h>
+#include <core/scheduler.h>
 #include <core/timer.h>
 
-bool isTooClose(const std::vector<Point> &placements, const Point &newPlacement) {
-    for (const auto &placement : placements) {
-        if (newPlacement.distanceTo2(placement) < 100) {
-            return true;
+// Best of a batch of random solutions
+struct RandomCandidate {
+    long long score = 0;
+    std::optional<Solution> solution;
+};
+
+// Finds the best of many random solutions for randomTime seconds of the time it is given, and then improves it with
+// hill climbing for as long as it is given time
+// Its state is checkpointed every checkpointInterval seconds, hill climbing only keeps the best solution, so the best
+// solution, the progress through the phases and the RNG state are enough to continue hill climbing exactly where it was
+// The random phase resumes with its best solution and elapsed time, but its candidates come from the per-thread RNG
+// streams, which are shared by all jobs and seeded anew on every run, so it draws different candidates after resuming
+class BruteJob {
+    Program &program;
+    std::shared_ptr<Problem> problem;
+
+    oneapi::tbb::enumerable_thread_specific<std::mt19937> &threadRngs;
+    std::mt19937 rng;
+
+    double randomTime;
+    double randomElapsed = 0;
+    std::size_t randomIteration = 0;
+
+    Solution bestSolution;
+    long long bestScore;
+
+    MoveSet moves;
+    std::optional<ScoringEngine> engine;
+    std::optional<PlacementGrid> grid;
+    std::size_t optimizeIteration = 0;
+
+    // The job is finished once it spent its optimization time, or optimized this many rounds in a row without improving
+    double optimizeTime;
+    double optimizeElapsed = 0;
+    std::size_t maxStaleRounds;
+    std::size_t staleRounds = 0;
+
+    std::filesystem::path checkpointPath;
+    double checkpointInterval;
+    Timer checkpointTimer;
+
+public:
+    BruteJob(Program &program,
+             const Solution &initialSolution,
+             long long initialScore,
+             oneapi::tbb::enumerable_thread_specific<std::mt19937> &threadRngs,
+             std::mt19937 seededRng,
+             double randomTime,
+             double optimizeTime,
+             std::size_t maxStaleRounds,
+             double checkpointInterval)
+            : program(program),
+              problem(initialSolution.problem),
+              threadRngs(threadRngs),
+              rng(seededRng),
+              randomTime(randomTime),
+              bestSolution(initialSolution),
+              bestScore(initialScore),
+              moves(*initialSolution.problem),
+              optimizeTime(optimizeTime),
+              maxStaleRounds(maxStaleRounds),
+              checkpointPath(program.getCheckpointPath(std::to_string(initialSolution.problem->id))),
+              checkpointInterval(checkpointInterval) {}
+
+    long long run(double seconds) {
+        Timer timer;
+
+        if (randomElapsed < randomTime) {
+            runRandom(std::min(seconds, randomTime - randomElapsed));
         }
-    }
-
-    return false;
-}
 
-Solution generateRandomSolution(const std::shared_ptr<Problem> &problem) {
-    std::vector<Point> possiblePlacements;
+        double remainingTime = std::min(seconds - timer.elapsedSeconds(), optimizeTime - optimizeElapsed);
+        if (remainingTime > 0) {
+            long long startScore = bestScore;
+            optimize(remainingTime);
+            staleRounds = bestScore > startScore ? 0 : staleRounds + 1;
+        }
 
-    Point nextPlacement = problem->stage.bottomLeft;
-    while (problem->stage.isInside(nextPlacement)) {
-        if (!isTooClose(possiblePlacements, nextPlacement)) {
-            possiblePlacements.emplace_back(nextPlacement);
+        if (isFinished()) {
+            std::cout << *problem << "Finished after " << optimizeElapsed << " seconds of optimization, the last "
+                      << staleRounds << " rounds without improvement" << std::endl;
         }
 
-        nextPlacement.x += 10;
+        // The engine updates closeness factors incrementally, so the submitted score is computed from scratch
+        program.submit(bestSolution);
+        saveCheckpoint();
+
+        return bestScore;
+    }
+
+    bool isFinished() const {
+        return engine && (optimizeElapsed >= optimizeTime || staleRounds >= maxStaleRounds);
     }
 
-    nextPlacement = {problem->stage.bottomLeft.x, problem->stage.bottomLeft.y + problem->stage.height};
-    while (problem->stage.isInside(nextPlacement)) {
-        if (!isTooClose(possiblePlacements, nextPlacement)) {
-            possiblePlacements.emplace_back(nextPlacement);
+    // Restores the state of the last checkpoint of the problem, returns false if there is no valid checkpoint
+    bool loadCheckpoint() {
+        auto checkpoint = CheckpointReader::load(checkpointPath);
+        if (!checkpoint || checkpoint->read<int>() != problem->id) {
+            return false;
         }
 
-        nextPlacement.x += 10;
-    }
+        auto checkpointRandomElapsed = checkpoint->read<double>();
+        auto checkpointRandomIteration = checkpoint->read<std::uint64_t>();
+        auto checkpointOptimizeIteration = checkpoint->read<std::uint64_t>();
+        auto checkpointOptimizeElapsed = checkpoint->read<double>();
+        auto checkpointStaleRounds = checkpoint->read<std::uint64_t>();
+        auto optimizing = checkpoint->read<std::uint8_t>();
+        auto checkpointScore = checkpoint->read<long long>();
+        auto placements = checkpoint->readVector<Point>();
+        auto volumes = checkpoint->readVector<double>();
+
+        std::mt19937 checkpointRng;
+        checkpoint->readRng(checkpointRng);
+
+        Solution checkpointSolution(problem, placements, volumes);
+        if (!checkpoint->isValid() || volumes.size() != placements.size() || !checkpointSolution.isValid()) {
+            return false;
+        }
 
-    nextPlacement = problem->stage.bottomLeft;
-    while (problem->stage.isInside(nextPlacement)) {
-        if (!isTooClose(possiblePlacements, nextPlacement)) {
-            possiblePlacements.emplace_back(nextPlacement);
+        randomElapsed = checkpointRandomElapsed;
+        randomIteration = checkpointRandomIteration;
+        optimizeIteration = checkpointOptimizeIteration;
+        optimizeElapsed = checkpointOptimizeElapsed;
+        staleRounds = checkpointStaleRounds;
+        bestSolution = checkpointSolution;
+        bestScore = checkpointScore;
+        rng = checkpointRng;
+
+        if (optimizing != 0) {
+            startOptimizing();
         }
 
-        nextPlacement.y += 10;
+        return true;
     }
 
-    nextPlacement = {problem->stage.bottomLeft.x + problem->stage.width, problem->stage.bottomLeft.y};
-    while (problem->stage.isInside(nextPlacement)) {
-        if (!isTooClose(possiblePlacements, nextPlacement)) {
-            possiblePlacements.emplace_back(nextPlacement);
+private:
+    void runRandom(double seconds) {
+        if (randomElapsed == 0) {
+            std::cout << *problem << "Finding best random solution for " << randomTime << " seconds" << std::endl;
         }
 
-        nextPlacement.y += 10;
+        // Random solutions are generated and scored in batches of this many in parallel
+        auto batchSize = static_cast<std::size_t>(4 * oneapi::tbb::this_task_arena::max_concurrency());
+
+        Timer randomTimer;
+        double startElapsed = randomElapsed;
+
+        // Every thread generates candidates with its own RNG stream, and each batch is reduced to its best candidate
+        // Ties are broken towards the candidate with the lower index in the batch
+        while (randomTimer.elapsedSeconds() < seconds) {
+            auto batchBest = oneapi::tbb::parallel_reduce(
+                    oneapi::tbb::blocked_range<std::size_t>(0, batchSize),
+                    RandomCandidate(),
+                    [&](const oneapi::tbb::blocked_range<std::size_t> &range, RandomCandidate best) {
+                        auto &threadRng = threadRngs.local();
+
+                        for (std::size_t i = range.begin(); i != range.end(); i++) {
+                            auto solution = generateRandomSolution(problem, threadRng);
+                            if (!solution) {
+                                continue;
+                            }
+
+                            auto score = solution->getScore();
+                            if (!best.solution || score > best.score) {
+                                best = {score, std::move(solution)};
+                            }
+                        }
+
+                        return best;
+                    },
+                    [](const RandomCandidate &lhs, const RandomCandidate &rhs) {
+                        return !lhs.solution || (rhs.solution && rhs.score > lhs.score) ? rhs : lhs;
+                    }
+            );
+
+            randomIteration += batchSize;
+
+            if (batchBest.solution && batchBest.score > bestScore) {
+                bestSolution = *batchBest.solution;
+                bestScore = batchBest.score;
+            }
+
+            if (checkpointTimer.elapsedSeconds() >= checkpointInterval) {
+                randomElapsed = startElapsed + randomTimer.elapsedSeconds();
+                saveCheckpoint();
+            }
+        }
+
+        randomElapsed = startElapsed + randomTimer.elapsedSeconds();
+
+        if (randomElapsed >= randomTime) {
+            std::cout << *problem << "Generated " << randomIteration << " random solutions ("
+                      << static_cast<long long>(static_cast<double>(randomIteration) / randomElapsed)
+                      << " per second)" << std::endl;
+        }
     }
 
-    std::random_device randomDevice;
-    std::mt19937 rng(randomDevice());
+    void optimize(double seconds) {
+        if (!engine) {
+            std::cout << *problem << "Optimizing best random solution" << std::endl;
+            startOptimizing();
+        }
 
-    std::uniform_real_distribution<double> xDist(problem->stage.bottomLeft.x,
-                                                 problem->stage.bottomLeft.x + problem->stage.width);
-    std::uniform_real_distribution<double> yDist(problem->stage.bottomLeft.y,
-                                                 problem->stage.bottomLeft.y + problem->stage.height);
+        Timer optimizeTimer;
+        double startElapsed = optimizeElapsed;
+        std::size_t iterations = 0;
 
-    while (possiblePlacements.size() < problem->musicians.size()) {
-        while (true) {
-            Point point(xDist(rng), yDist(rng));
+        while (optimizeTimer.elapsedSeconds() < seconds) {
+            optimizeIteration++;
+            iterations++;
+
+            auto move = moves.generate(MoveSet::getType(optimizeIteration), *grid, rng);
+            if (move) {
+                auto newScore = tryMove(*engine, *move);
+                if (newScore > bestScore) {
+                    commitMove(*engine, *grid, *move);
+                    bestScore = newScore;
+                } else {
+                    engine->rollback();
+                }
+            }
 
-            if (!isTooClose(possiblePlacements, point)) {
-                possiblePlacements.emplace_back(point);
-                break;
+            if (checkpointTimer.elapsedSeconds() >= checkpointInterval) {
+                optimizeElapsed = startElapsed + optimizeTimer.elapsedSeconds();
+                bestSolution = engine->toSolution();
+                saveCheckpoint();
             }
         }
-    }
 
-    std::shuffle(possiblePlacements.begin(), possiblePlacements.end(), rng);
+        optimizeElapsed = startElapsed + optimizeTimer.elapsedSeconds();
+        bestSolution = engine->toSolution();
+        std::cout << *problem << "Ran " << iterations << " optimization iterations" << std::endl;
+    }
 
-    std::vector<Point> placements;
-    placements.reserve(problem->musicians.size());
+    void startOptimizing() {
+        engine.emplace(bestSolution);
+        bestScore = engine->getScore();
 
-    for (std::size_t i = 0; i < problem->musicians.size(); i++) {
-        placements.emplace_back(possiblePlacements[i]);
+        grid.emplace(problem->stage, engine->getPlacements());
     }
 
-    return {problem, placements};
-}
+    // Runs from the search loops, which stall while the checkpoint is flushed to disk, so checkpointInterval shouldn't
+    // be much shorter than a few fsyncs take
+    void saveCheckpoint() {
+        CheckpointWriter checkpoint;
+        checkpoint.write(problem->id);
+        checkpoint.write(randomElapsed);
+        checkpoint.write(static_cast<std::uint64_t>(randomIteration));
+        checkpoint.write(static_cast<std::uint64_t>(optimizeIteration));
+        checkpoint.write(optimizeElapsed);
+        checkpoint.write(static_cast<std::uint64_t>(staleRounds));
+        checkpoint.write(static_cast<std::uint8_t>(engine.has_value()));
+        checkpoint.write(bestScore);
+        checkpoint.write(bestSolution.placements);
+        checkpoint.write(bestSolution.volumes);
+        checkpoint.writeRng(rng);
+
+        checkpoint.save(checkpointPath);
+        checkpointTimer.reset();
+    }
+};
 
 int main(int argc, char *argv[]) {
     Program program("brute");
     auto problems = program.parseArgs(argc, argv);
 
     std::random_device randomDevice;
-    std::mt19937 rng(randomDevice());
 
     double randomTime = 30;
     double optimizeTime = 150;
-    double submissionInterval = 60;
+    auto maxStaleRounds = static_cast<std::size_t>(std::stoul(getEnv("BRUTE_MAX_STALE_ROUNDS", "5")));
+
+    // By default every problem gets randomTime + optimizeTime seconds with all threads on average
+    auto threadCount = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
+    auto defaultTime = (randomTime + optimizeTime) * static_cast<double>(std::max<std::size_t>(
+            (problems.size() + threadCount - 1) / threadCount, 1));
+
+    double totalTime = std::stod(getEnv("SCHEDULER_TIME", std::to_string(defaultTime)));
+    double roundTime = std::stod(getEnv("SCHEDULER_ROUND_TIME", "10"));
+    double checkpointInterval = std::stod(getEnv("CHECKPOINT_INTERVAL", "5"));
+
+    std::atomic<unsigned int> nextStream{0};
+    unsigned int baseSeed = randomDevice();
+    oneapi::tbb::enumerable_thread_specific<std::mt19937> threadRngs([&] {
+        std::seed_seq seed{baseSeed, nextStream++};
+        return std::mt19937(seed);
+    });
+
+    // The handles only load their problems when the scheduler first schedules them, and the scheduler releases every
+    // problem as soon as its job is finished, so only the problems being worked on are kept in memory
+    Scheduler scheduler(program, totalTime, roundTime);
+    scheduler.run(problems, [&](const std::shared_ptr<Problem> &problem) -> std::unique_ptr<BruteJob> {
+        std::seed_seq seed{baseSeed, nextStream++};
+        std::mt19937 jobRng(seed);
+
+        if (program.isResumeEnabled()) {
+            auto job = std::make_unique<BruteJob>(program, Solution(problem, {}, {}), 0, threadRngs, jobRng,
+                                                  randomTime, optimizeTime, maxStaleRounds, checkpointInterval);
+
+            if (job->loadCheckpoint()) {
+                std::cout << *problem << "Resuming from checkpoint" << std::endl;
+                return job;
+            }
+
+            std::cout << *problem << "No valid checkpoint found" << std::endl;
+        }
 
-    for (const auto &problem : problems) {
-        Solution bestSolution(problem, {}, {});
-        long long bestScore = 0;
+        Solution initialSolution(problem, {}, {});
+        long long initialScore = 0;
 
         if (program.isServerEnabled()) {
             std::cout << *problem << "Retrieving best global solution" << std::endl;
             auto bestGlobalSolution = program.getBestGlobalSolution(problem);
             if (bestGlobalSolution) {
-                bestSolution = *bestGlobalSolution;
-                bestScore = bestGlobalSolution->getScore();
-                program.submit(bestSolution, bestScore);
+                initialSolution = *bestGlobalSolution;
+                initialScore = bestGlobalSolution->getScore();
+                program.submit(initialSolution, initialScore);
             } else {
                 std::cout << *problem << "No best global solution found" << std::endl;
             }
         }
 
-        if (bestScore == 0) {
+        if (initialScore == 0) {
             std::cout << *problem << "Generating initial random solution" << std::endl;
 
-            bestSolution = generateRandomSolution(problem);
-            bestScore = bestSolution.getScore();
-            program.submit(bestSolution, bestScore);
-        }
-
-        std::cout << *problem << "Finding best random solution for " << randomTime << " seconds" << std::endl;
-
-        Timer randomTimer;
-        std::size_t randomIteration = 0;
-
-        while (randomTimer.elapsedSeconds() < randomTime) {
-            randomIteration++;
-            auto newSolution = generateRandomSolution(problem);
-
-            auto newScore = newSolution.getScore();
-            if (newScore > bestScore) {
-                bestSolution = newSolution;
-                bestScore = newScore;
+            auto randomSolution = generateRandomSolution(problem);
+            if (!randomSolution) {
+                std::cout << *problem << "Stage can't fit all " << problem->musicians.size() << " musicians"
+                          << std::endl;
+                return nullptr;
             }
-        }
-
-        program.submit(bestSolution, bestScore);
-        std::cout << *problem << "Generated " << randomIteration << " random solutions" << std::endl;
-
-        std::uniform_int_distribution<std::size_t> indexDist(0, problem->musicians.size() - 1);
-        std::uniform_real_distribution<double> deltaDist(-5.0, 5.0);
-        std::uniform_real_distribution<double> xDist(problem->stage.bottomLeft.x,
-                                                     problem->stage.bottomLeft.x + problem->stage.width);
-        std::uniform_real_distribution<double> yDist(problem->stage.bottomLeft.y,
-                                                     problem->stage.bottomLeft.y + problem->stage.height);
-
-        Timer optimizeTimer;
-        Timer submissionTimer;
-
-        std::size_t optimizeIteration = 0;
 
-        std::cout << *problem << "Optimizing for "
-                  << optimizeTime << " seconds, reporting every "
-                  << submissionInterval << " seconds"
-                  << std::endl;
-
-        while (optimizeTimer.elapsedSeconds() < optimizeTime) {
-            optimizeIteration++;
-            Solution newSolution(bestSolution);
-
-            switch (optimizeIteration % 3) {
-                case 0: {
-                    std::swap(newSolution.placements[indexDist(rng)], newSolution.placements[indexDist(rng)]);
-                    break;
-                }
-                case 1: {
-                    auto &placement = newSolution.placements[indexDist(rng)];
-                    placement.x += deltaDist(rng);
-                    placement.y += deltaDist(rng);
-                    break;
-                }
-                case 2: {
-                    auto &placement = newSolution.placements[indexDist(rng)];
-                    placement.x = xDist(rng);
-                    placement.y = yDist(rng);
-                    break;
-                }
-            }
-
-            if (!newSolution.isValid()) {
-                continue;
-            }
-
-            auto newScore = newSolution.getScore();
-            if (newScore > bestScore) {
-                bestSolution = newSolution;
-                bestScore = newScore;
-            }
-
-            if (submissionTimer.elapsedSeconds() >= submissionInterval) {
-                program.submit(bestSolution, bestScore);
-                submissionTimer.reset();
-            }
+            initialSolution = *randomSolution;
+            initialScore = initialSolution.getScore();
+            program.submit(initialSolution, initialScore);
         }
 
-        program.submit(bestSolution, bestScore);
-        std::cout << *problem << "Ran " << optimizeIteration << " optimization iterations" << std::endl;
-    }
+        return std::make_unique<BruteJob>(program, initialSolution, initialScore, threadRngs, jobRng, randomTime,
+                                          optimizeTime, maxStaleRounds, checkpointInterval);
+    });
 
     return 0;
 }
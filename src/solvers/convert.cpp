@@ -0,0 +1,31 @@
+#include <iostream>
+#include <string>
+
+#include <core/models.h>
+#include <core/program.h>
+#include <core/timer.h>
+
+// Writes the binary version of every problem next to its JSON file, which solvers load instead of the JSON file
+int main(int argc, char *argv[]) {
+    Program program("convert");
+
+    auto problems = program.parseArgs(argc, argv);
+
+    Timer timer;
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        auto file = program.getProblemsRoot() / (std::to_string(problem->id) + ".bin");
+
+        if (problem->writeBinary(file)) {
+            std::cout << *problem << "Wrote " << file.string() << std::endl;
+        } else {
+            std::cout << *problem << "Something went wrong while writing " << file.string() << std::endl;
+        }
+    }
+
+    std::cout << "Converted " << problems.size() << " problems in " << timer.elapsedSeconds() << " seconds" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <core/generators.h>
+#include <core/gradient.h>
+#include <core/models.h>
+#include <core/moves.h>
+#include <core/program.h>
+#include <core/timer.h>
+#include <core/timer.h>
+
+// Moves every musician stepLength in the direction of its gradient
+// Gradients of different musicians differ by orders of magnitude, so only their directions are used, which still
+// increases the relaxed score for small enough steps
+// Placements are clamped to the stage, and musicians whose new placement would be too close to another musician stay
+// where they are, musicians with larger gradients are moved first
+std::vector<Point> takeStep(const Solution &solution, const std::vector<Point> &gradient, double stepLength) {
+    const auto &stage = solution.problem->stage;
+
+    std::vector<double> norms(gradient.size());
+    for (std::size_t i = 0; i < gradient.size(); i++) {
+        norms[i] = std::hypot(gradient[i].x, gradient[i].y);
+    }
+
+    std::vector<std::size_t> order(gradient.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+        return norms[lhs] > norms[rhs];
+    });
+
+    PlacementGrid grid(stage, solution.placements);
+    for (std::size_t i : order) {
+        if (norms[i] == 0) {
+            break;
+        }
+
+        const auto &placement = solution.placements[i];
+        double scale = stepLength / norms[i];
+
+        Point target(std::clamp(placement.x + scale * gradient[i].x, stage.bottomLeft.x,
+                                stage.bottomLeft.x + stage.width),
+                     std::clamp(placement.y + scale * gradient[i].y, stage.bottomLeft.y,
+                                stage.bottomLeft.y + stage.height));
+
+        if (grid.canMove(i, target)) {
+            grid.move(i, target);
+        }
+    }
+
+    return grid.getPlacements();
+}
+
+// Returns the placements with the given number of random jitters applied, to escape the local optimum the gradient
+// steps converged to
+template<typename Rng>
+std::vector<Point> perturb(const Solution &solution, MoveSet &moves, Rng &rng, std::size_t jitters) {
+    PlacementGrid grid(solution.problem->stage, solution.placements);
+    for (std::size_t i = 0; i < jitters; i++) {
+        auto move = moves.generate(MoveType::JITTER, grid, rng);
+        if (move) {
+            grid.move(move->musician1, move->placement);
+        }
+    }
+
+    return grid.getPlacements();
+}
+
+int main(int argc, char *argv[]) {
+    Program program("gradient");
+    auto problems = program.parseArgs(argc, argv);
+
+    double optimizeTime = 120;
+    double submissionInterval = 30;
+
+    // Step lengths are the distance moved by every musician
+    double initialStepLength = 5;
+    double minStepLength = 1e-3;
+
+    std::random_device randomDevice;
+    std::mt19937 rng(randomDevice());
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        if (problem->musicians.empty()) {
+            continue;
+        }
+
+        auto type = problem->id <= 55 ? ScoreType::LIGHTNING : ScoreType::FULL;
+
+        Solution solution(problem, {}, {});
+        long long score = 0;
+
+        if (program.isServerEnabled()) {
+            std::cout << *problem << "Retrieving best global solution" << std::endl;
+            auto bestGlobalSolution = program.getBestGlobalSolution(problem);
+            if (bestGlobalSolution) {
+                solution = *bestGlobalSolution;
+                score = solution.getScore(type);
+            } else {
+                std::cout << *problem << "No best global solution found" << std::endl;
+            }
+        }
+
+        if (score == 0) {
+            std::cout << *problem << "Generating initial random solution" << std::endl;
+
+            auto randomSolution = generateRandomSolution(problem);
+            if (!randomSolution) {
+                std::cout << *problem << "Stage can't fit all " << problem->musicians.size() << " musicians"
+                          << std::endl;
+                continue;
+            }
+
+            solution = *randomSolution;
+            score = solution.getScore(type);
+        }
+
+        program.submit(solution, score);
+
+        std::cout << *problem << "Following gradients for " << optimizeTime << " seconds" << std::endl;
+
+        Timer optimizeTimer;
+        Timer submissionTimer;
+
+        Solution bestSolution = solution;
+        long long bestScore = score;
+
+        MoveSet moves(*problem);
+        std::size_t jitters = std::max<std::size_t>(problem->musicians.size() / 10, 1);
+
+        std::size_t steps = 0;
+        std::size_t evaluations = 0;
+        std::size_t restarts = 0;
+        double stepLength = initialStepLength;
+
+        while (optimizeTimer.elapsedSeconds() < optimizeTime) {
+            // Once the steps converged, they continue from a perturbed copy of the best solution until time runs out
+            if (stepLength < minStepLength) {
+                solution = Solution(problem, perturb(bestSolution, moves, rng, jitters));
+                score = solution.getScore(type);
+                stepLength = initialStepLength;
+
+                evaluations++;
+                restarts++;
+            }
+
+            auto gradient = getScoreGradient(solution, type);
+
+            bool allZero = std::all_of(gradient.begin(), gradient.end(), [](const Point &point) {
+                return point.x == 0 && point.y == 0;
+            });
+
+            if (allZero) {
+                stepLength = 0;
+                continue;
+            }
+
+            // Backtracking on the exact score, as the relaxed score ignores ceilings and changes in visibility
+            while (stepLength >= minStepLength && optimizeTimer.elapsedSeconds() < optimizeTime) {
+                Solution newSolution(problem, takeStep(solution, gradient, stepLength));
+
+                long long newScore = newSolution.getScore(type);
+                evaluations++;
+
+                if (newScore > score) {
+                    solution = newSolution;
+                    score = newScore;
+                    stepLength *= 1.5;
+                    steps++;
+                    break;
+                }
+
+                stepLength /= 2;
+            }
+
+            if (score > bestScore) {
+                bestSolution = solution;
+                bestScore = score;
+            }
+
+            if (submissionTimer.elapsedSeconds() >= submissionInterval) {
+                program.submit(bestSolution, bestScore);
+                submissionTimer.reset();
+            }
+        }
+
+        program.submit(bestSolution, bestScore);
+        std::cout << *problem << "Took " << steps << " gradient steps with " << evaluations << " score evaluations and "
+                  << restarts << " restarts" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/candidates.h>
+#include <core/models.h>
+#include <core/program.h>
+#include <core/timer.h>
+
+// Musicians placed so far, with the impact of each of them on every attendee that sees it
+// Gains are scored like LIGHTNING problems, every musician at volume 10 if its impact is positive and muted otherwise
+class GreedyState {
+    const Problem &problem;
+    std::size_t attendeeCount;
+
+    std::vector<double> placedXs;
+    std::vector<double> placedYs;
+
+    // Placed-major, the entries of placed musician i and attendee a are at i * attendeeCount + a
+    std::vector<char> visible;
+    std::vector<double> impacts;
+
+    std::vector<double> impactSums;
+
+public:
+    explicit GreedyState(const Problem &problem) : problem(problem), attendeeCount(problem.attendees.size()) {}
+
+    std::size_t getPlacedCount() const {
+        return placedXs.size();
+    }
+
+    // Returns the score gain of placing a musician playing the given instrument at the given point
+    // Placing more musicians can lower the gain by blocking the view on the new point, but also raise it by blocking
+    // placed musicians whose impact is negative, so gains are not monotone
+    double getGain(int instrument, const Point &point) const {
+        std::size_t placedCount = getPlacedCount();
+
+        struct Partial {
+            double impactSum = 0;
+            std::vector<double> lostImpacts;
+        };
+
+        oneapi::tbb::combinable<Partial> partials([&] {
+            return Partial{0, std::vector<double>(placedCount)};
+        });
+
+        oneapi::tbb::parallel_for(
+                oneapi::tbb::blocked_range<std::size_t>(0, attendeeCount),
+                [&](const oneapi::tbb::blocked_range<std::size_t> &range) {
+                    auto &partial = partials.local();
+
+                    for (std::size_t attendeeIdx = range.begin(); attendeeIdx != range.end(); attendeeIdx++) {
+                        double attendeeX = problem.attendeeXs[attendeeIdx];
+                        double attendeeY = problem.attendeeYs[attendeeIdx];
+
+                        if (isVisible(point, attendeeIdx)) {
+                            partial.impactSum += getImpact(instrument, point, attendeeIdx);
+                        }
+
+                        for (std::size_t i = 0; i < placedCount; i++) {
+                            std::size_t idx = i * attendeeCount + attendeeIdx;
+                            if (visible[idx] && isBlocking(placedXs[i], placedYs[i], attendeeX, attendeeY,
+                                                           point.x, point.y, 5)) {
+                                partial.lostImpacts[i] += impacts[idx];
+                            }
+                        }
+                    }
+                }
+        );
+
+        double impactSum = 0;
+        std::vector<double> lostImpacts(placedCount);
+        partials.combine_each([&](const Partial &partial) {
+            impactSum += partial.impactSum;
+            for (std::size_t i = 0; i < placedCount; i++) {
+                lostImpacts[i] += partial.lostImpacts[i];
+            }
+        });
+
+        double gain = 10 * std::max(impactSum, 0.0);
+        for (std::size_t i = 0; i < placedCount; i++) {
+            if (lostImpacts[i] != 0) {
+                gain += 10 * (std::max(impactSums[i] - lostImpacts[i], 0.0) - std::max(impactSums[i], 0.0));
+            }
+        }
+
+        return gain;
+    }
+
+    void place(int instrument, const Point &point) {
+        std::size_t placedCount = getPlacedCount();
+
+        oneapi::tbb::parallel_for(std::size_t(0), placedCount, [&](std::size_t i) {
+            for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+                std::size_t idx = i * attendeeCount + attendeeIdx;
+                if (visible[idx] && isBlocking(placedXs[i], placedYs[i],
+                                               problem.attendeeXs[attendeeIdx], problem.attendeeYs[attendeeIdx],
+                                               point.x, point.y, 5)) {
+                    visible[idx] = 0;
+                    impactSums[i] -= impacts[idx];
+                }
+            }
+        });
+
+        visible.resize(visible.size() + attendeeCount);
+        impacts.resize(impacts.size() + attendeeCount);
+
+        double impactSum = 0;
+        for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+            std::size_t idx = placedCount * attendeeCount + attendeeIdx;
+
+            visible[idx] = isVisible(point, attendeeIdx);
+            impacts[idx] = getImpact(instrument, point, attendeeIdx);
+
+            if (visible[idx]) {
+                impactSum += impacts[idx];
+            }
+        }
+
+        placedXs.emplace_back(point.x);
+        placedYs.emplace_back(point.y);
+        impactSums.emplace_back(impactSum);
+    }
+
+private:
+    bool isVisible(const Point &point, std::size_t attendeeIdx) const {
+        if (problem.isPillarBlocked(attendeeIdx, point)) {
+            return false;
+        }
+
+        return countBlocking(point.x, point.y, problem.attendeeXs[attendeeIdx], problem.attendeeYs[attendeeIdx],
+                             placedXs.data(), placedYs.data(), 0, placedXs.size(), placedXs.size(), 5, true) == 0;
+    }
+
+    double getImpact(int instrument, const Point &point, std::size_t attendeeIdx) const {
+        double taste = 1'000'000.0 * problem.getAttendeeTastes(attendeeIdx)[instrument];
+        Point position(problem.attendeeXs[attendeeIdx], problem.attendeeYs[attendeeIdx]);
+        return std::ceil(taste / position.distanceTo2(point));
+    }
+};
+
+// Gain of placing an instrument at a candidate point, computed when placedCount musicians were placed
+struct Candidate {
+    double gain;
+    int instrument;
+    std::size_t point;
+    std::size_t placedCount;
+
+    bool operator<(const Candidate &other) const {
+        return gain < other.gain;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    Program program("greedy");
+    auto problems = program.parseArgs(argc, argv);
+
+    // After this many seconds, remaining musicians are placed by their last computed gains without re-evaluating them
+    double evaluationTime = 20;
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        std::size_t musicianCount = problem->musicians.size();
+        if (musicianCount == 0) {
+            continue;
+        }
+
+        Timer timer;
+
+        // Candidate points are all at least 10 apart, so the only point a placement makes invalid is its own
+        auto points = generateCandidatePoints(*problem);
+        if (points.size() < musicianCount) {
+            std::cout << *problem << "Stage can't fit all " << musicianCount << " musicians" << std::endl;
+            continue;
+        }
+
+        auto values = getPointValues(*problem, points, false);
+
+        std::vector<std::vector<std::size_t>> remainingMusicians(problem->instrumentCount);
+        for (std::size_t i = musicianCount; i-- > 0;) {
+            remainingMusicians[problem->musicians[i]].emplace_back(i);
+        }
+
+        // With nothing placed, the gains are exactly the values of the points
+        std::vector<Candidate> initialCandidates;
+        for (std::size_t instrument = 0; instrument < problem->instrumentCount; instrument++) {
+            if (remainingMusicians[instrument].empty()) {
+                continue;
+            }
+
+            for (std::size_t p = 0; p < points.size(); p++) {
+                double gain = 10 * std::max(values[instrument * points.size() + p], 0.0);
+                initialCandidates.push_back({gain, static_cast<int>(instrument), p, 0});
+            }
+        }
+
+        // Lazy greedy in the style of CELF: a candidate at the top of the heap whose gain is up-to-date is placed
+        // without re-evaluating the others, assuming their stale gains bound their current gains
+        // That mostly holds as placements mostly block views, but a placement that blocks a negative impact raises
+        // gains, so this is a heuristic and may miss a candidate whose stale gain undersells it
+        std::priority_queue<Candidate> candidates(std::less<Candidate>(), std::move(initialCandidates));
+
+        GreedyState state(*problem);
+        std::vector<char> pointUsed(points.size());
+        std::vector<Point> placements(musicianCount);
+
+        std::size_t evaluations = 0;
+
+        while (state.getPlacedCount() < musicianCount) {
+            auto candidate = candidates.top();
+            candidates.pop();
+
+            if (pointUsed[candidate.point] || remainingMusicians[candidate.instrument].empty()) {
+                continue;
+            }
+
+            const auto &point = points[candidate.point];
+
+            bool isStale = candidate.placedCount != state.getPlacedCount();
+            if (isStale && timer.elapsedSeconds() < evaluationTime) {
+                candidate.gain = state.getGain(candidate.instrument, point);
+                candidate.placedCount = state.getPlacedCount();
+                candidates.push(candidate);
+
+                evaluations++;
+                continue;
+            }
+
+            state.place(candidate.instrument, point);
+            pointUsed[candidate.point] = 1;
+
+            placements[remainingMusicians[candidate.instrument].back()] = point;
+            remainingMusicians[candidate.instrument].pop_back();
+        }
+
+        Solution solution(problem, placements);
+        long long score = solution.getScore();
+
+        std::cout << *problem << "Placed " << musicianCount << " musicians with " << evaluations
+                  << " gain evaluations in " << timer.elapsedSeconds() << " seconds, score " << score << std::endl;
+
+        program.submit(solution, score);
+    }
+
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/config.h>
+#include <core/generators.h>
+#include <core/models.h>
+#include <core/moves.h>
+#include <core/program.h>
+#include <core/slot.h>
+#include <core/tasks.h>
+#include <core/timer.h>
+
+// Hill climbing strategies that compete for threads
+// MIXED cycles through the moves like brute, SWAP, JITTER and TELEPORT only use one kind of move, EDGE teleports
+// musicians to free points on the edges of the stage, and RESTART climbs from a new random solution every epoch
+enum class Strategy {
+    MIXED,
+    SWAP,
+    JITTER,
+    TELEPORT,
+    EDGE,
+    RESTART
+};
+
+constexpr std::array<Strategy, 6> STRATEGIES{
+        Strategy::MIXED,
+        Strategy::SWAP,
+        Strategy::JITTER,
+        Strategy::TELEPORT,
+        Strategy::EDGE,
+        Strategy::RESTART
+};
+
+std::string getStrategyName(Strategy strategy) {
+    switch (strategy) {
+        case Strategy::MIXED:
+            return "mixed";
+        case Strategy::SWAP:
+            return "swap";
+        case Strategy::JITTER:
+            return "jitter";
+        case Strategy::TELEPORT:
+            return "teleport";
+        case Strategy::EDGE:
+            return "edge";
+        default:
+            return "restart";
+    }
+}
+
+// Discounted UCB1 over the strategies, rewarded with the improvement of the shared best score per thread-second
+// Rewards and pull counts decay every epoch, so the controller follows which strategy works best at the moment
+class StrategyBandit {
+    double decay;
+
+    std::array<double, STRATEGIES.size()> rewards{};
+    std::array<double, STRATEGIES.size()> pulls{};
+
+public:
+    explicit StrategyBandit(double decay) : decay(decay) {}
+
+    // Assigns a strategy to every worker, pulls made for earlier workers lower the bonus of their strategy so threads
+    // spread over the strategies that look promising
+    std::vector<Strategy> assign(std::size_t workerCount) const {
+        auto virtualPulls = pulls;
+
+        double maxMean = 0;
+        for (std::size_t i = 0; i < STRATEGIES.size(); i++) {
+            if (pulls[i] > 0) {
+                maxMean = std::max(maxMean, rewards[i] / pulls[i]);
+            }
+        }
+
+        std::vector<Strategy> strategies;
+        strategies.reserve(workerCount);
+
+        for (std::size_t worker = 0; worker < workerCount; worker++) {
+            double totalPulls = 0;
+            for (double count : virtualPulls) {
+                totalPulls += count;
+            }
+
+            std::size_t best = 0;
+            double bestValue = -std::numeric_limits<double>::infinity();
+
+            for (std::size_t i = 0; i < STRATEGIES.size(); i++) {
+                double value = std::numeric_limits<double>::infinity();
+                if (virtualPulls[i] > 0) {
+                    // Means are scaled to [0, 1] so the exploration bonus has the same weight on every problem
+                    double mean = pulls[i] > 0 && maxMean > 0 ? rewards[i] / pulls[i] / maxMean : 0;
+                    value = mean + std::sqrt(2 * std::log(std::max(totalPulls, 1.0)) / virtualPulls[i]);
+                }
+
+                if (value > bestValue) {
+                    best = i;
+                    bestValue = value;
+                }
+            }
+
+            strategies.emplace_back(STRATEGIES[best]);
+            virtualPulls[best]++;
+        }
+
+        return strategies;
+    }
+
+    void update(const std::vector<Strategy> &strategies, const std::vector<double> &workerRewards) {
+        for (std::size_t i = 0; i < STRATEGIES.size(); i++) {
+            rewards[i] *= decay;
+            pulls[i] *= decay;
+        }
+
+        for (std::size_t worker = 0; worker < strategies.size(); worker++) {
+            auto i = static_cast<std::size_t>(strategies[worker]);
+            rewards[i] += workerRewards[worker];
+            pulls[i]++;
+        }
+    }
+};
+
+// A worker climbs from the shared best solution with the strategy it is assigned, and keeps its own state between
+// epochs unless the shared best solution improved in the meantime
+struct Worker {
+    std::shared_ptr<Problem> problem;
+
+    std::optional<ScoringEngine> engine;
+    std::optional<PlacementGrid> grid;
+    MoveSet moves;
+    std::mt19937 rng;
+
+    long long score = 0;
+    std::uint64_t epoch = 0;
+
+    std::size_t iterations = 0;
+
+    Worker(const std::shared_ptr<Problem> &problem, unsigned int seed) : problem(problem), moves(*problem), rng(seed) {}
+
+    // Runs the strategy for the given time or until stop is set, and publishes the result if it improves the best score
+    // Workers only accept improvements, so the state they end in is the best one they passed through, and the slot is
+    // published to at most once per round
+    void run(Strategy strategy,
+             double seconds,
+             const std::atomic<bool> &stop,
+             BestSolutionSlot &slot,
+             const std::vector<Point> &edgePoints) {
+        std::optional<Solution> randomSolution;
+        if (strategy == Strategy::RESTART) {
+            randomSolution = generateRandomSolution(problem, rng);
+        }
+
+        if (randomSolution) {
+            load(*randomSolution, 0);
+        } else if (auto snapshot = slot.get(engine ? epoch : 0); snapshot && (!engine || snapshot->score > score)) {
+            load(snapshot->solution, snapshot->epoch);
+        }
+
+        std::uniform_int_distribution<std::size_t> edgeDist(0, edgePoints.empty() ? 0 : edgePoints.size() - 1);
+
+        Timer timer;
+        while (timer.elapsedSeconds() < seconds && !stop.load(std::memory_order_relaxed)) {
+            for (int batch = 0; batch < 16; batch++) {
+                iterations++;
+
+                std::optional<Move> move;
+                if (strategy == Strategy::EDGE && !edgePoints.empty()) {
+                    move = moves.generateTeleport(edgePoints[edgeDist(rng)], *grid, rng);
+                } else {
+                    move = moves.generate(getMoveType(strategy), *grid, rng);
+                }
+
+                if (!move) {
+                    continue;
+                }
+
+                long long newScore = tryMove(*engine, *move);
+                if (newScore <= score) {
+                    engine->rollback();
+                    continue;
+                }
+
+                commitMove(*engine, *grid, *move);
+                score = newScore;
+            }
+        }
+
+        // Taking over the epoch of the published snapshot keeps the worker from reloading its own solution, a better
+        // one published in between has a later epoch and is loaded next round
+        if (score > slot.getBestScore()) {
+            if (auto published = slot.publish(engine->toSolution(), score); published != 0) {
+                epoch = published;
+            }
+        }
+    }
+
+private:
+    void load(const Solution &solution, std::uint64_t solutionEpoch) {
+        engine.emplace(solution);
+        grid.emplace(problem->stage, solution.placements);
+
+        score = engine->getScore();
+        epoch = solutionEpoch;
+    }
+
+    MoveType getMoveType(Strategy strategy) const {
+        switch (strategy) {
+            case Strategy::SWAP:
+                return MoveType::SWAP;
+            case Strategy::JITTER:
+                return MoveType::JITTER;
+            case Strategy::TELEPORT:
+                return MoveType::TELEPORT;
+            default:
+                return MoveSet::getType(iterations);
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+    Program program("portfolio");
+    auto problems = program.parseArgs(argc, argv);
+
+    std::random_device randomDevice;
+
+    double portfolioTime = std::stod(getEnv("PORTFOLIO_TIME", "180"));
+    double epochTime = std::stod(getEnv("PORTFOLIO_EPOCH", "2"));
+    double submissionInterval = std::stod(getEnv("PORTFOLIO_SUBMISSION_INTERVAL", "5"));
+
+    // Weight of the rewards of the previous epoch relative to the current one
+    double decay = std::stod(getEnv("PORTFOLIO_DECAY", "0.8"));
+
+    auto workerCount = static_cast<std::size_t>(std::stoul(getEnv(
+            "PORTFOLIO_WORKERS", std::to_string(oneapi::tbb::this_task_arena::max_concurrency()))));
+    workerCount = std::max<std::size_t>(workerCount, 1);
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        Solution initialSolution(problem, {}, {});
+        long long initialScore = 0;
+
+        if (program.isServerEnabled()) {
+            std::cout << *problem << "Retrieving best global solution" << std::endl;
+            auto bestGlobalSolution = program.getBestGlobalSolution(problem);
+            if (bestGlobalSolution) {
+                initialSolution = *bestGlobalSolution;
+                initialScore = bestGlobalSolution->getScore();
+                program.submit(initialSolution, initialScore);
+            } else {
+                std::cout << *problem << "No best global solution found" << std::endl;
+            }
+        }
+
+        if (initialScore == 0) {
+            std::cout << *problem << "Generating initial random solution" << std::endl;
+
+            auto randomSolution = generateRandomSolution(problem);
+            if (!randomSolution) {
+                std::cout << *problem << "Stage can't fit all " << problem->musicians.size() << " musicians"
+                          << std::endl;
+                continue;
+            }
+
+            initialSolution = *randomSolution;
+            initialScore = initialSolution.getScore();
+            program.submit(initialSolution, initialScore);
+        }
+
+        PlacementGrid edgeGrid(problem->stage);
+        addEdgePoints(edgeGrid, problem->stage);
+        const auto &edgePoints = edgeGrid.getPlacements();
+
+        std::vector<Worker> workers;
+        workers.reserve(workerCount);
+        for (std::size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(problem, randomDevice());
+        }
+
+        std::cout << *problem << "Running a portfolio of " << STRATEGIES.size() << " strategies on " << workerCount
+                  << " workers for " << portfolioTime << " seconds, reallocating every " << epochTime << " seconds"
+                  << std::endl;
+
+        BestSolutionSlot slot;
+        slot.publish(initialSolution, initialScore);
+
+        StrategyBandit bandit(decay);
+        std::array<std::size_t, STRATEGIES.size()> strategyEpochs{};
+
+        Timer timer;
+        std::atomic<bool> stop{false};
+
+        // Workers run on TBB tasks in epochs, between which the bandit reassigns strategies
+        // The main thread only polls the best solution slot and submits improvements
+        std::thread controller([&] {
+            while (!stop.load()) {
+                auto strategies = bandit.assign(workers.size());
+                for (auto strategy : strategies) {
+                    strategyEpochs[static_cast<std::size_t>(strategy)]++;
+                }
+
+                long long startScore = slot.getBestScore();
+                std::vector<long long> publishedScores(workers.size(), startScore);
+
+                Timer epochTimer;
+                double workerTime = getTaskTime(epochTime, workers.size());
+
+                runLongTasks(workers.size(), [&](std::size_t i) {
+                    workers[i].run(strategies[i], workerTime, stop, slot, edgePoints);
+                    publishedScores[i] = std::max(startScore, workers[i].score);
+                });
+
+                // Rewards are relative to the best score, so they are comparable between problems and over time
+                double elapsed = std::max(epochTimer.elapsedSeconds(), 1e-9);
+                double scale = static_cast<double>(std::max(std::llabs(startScore), 1LL));
+
+                std::vector<double> rewards(workers.size());
+                for (std::size_t i = 0; i < workers.size(); i++) {
+                    rewards[i] = static_cast<double>(publishedScores[i] - startScore) / scale / elapsed;
+                }
+
+                bandit.update(strategies, rewards);
+            }
+        });
+
+        std::uint64_t submittedEpoch = slot.getEpoch();
+        while (timer.elapsedSeconds() < portfolioTime) {
+            double remaining = portfolioTime - timer.elapsedSeconds();
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::min(submissionInterval, remaining)));
+
+            // The engines update closeness factors incrementally, so the submitted score is computed from scratch
+            if (auto snapshot = slot.get(submittedEpoch)) {
+                program.submit(snapshot->solution);
+                submittedEpoch = snapshot->epoch;
+            }
+        }
+
+        stop.store(true);
+        controller.join();
+
+        program.submit(slot.get()->solution);
+
+        std::size_t iterations = 0;
+        for (const auto &worker : workers) {
+            iterations += worker.iterations;
+        }
+
+        std::cout << *problem << "Ran " << iterations << " iterations, worker epochs per strategy:";
+        for (std::size_t i = 0; i < STRATEGIES.size(); i++) {
+            std::cout << ' ' << getStrategyName(STRATEGIES[i]) << '=' << strategyEpochs[i];
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -8,7 +8,9 @@ int main(int argc, char *argv[]) {
     Program program("starter");
     auto problems = program.parseArgs(argc, argv);
 
-    for (const auto &problem : problems) {
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
         std::vector<Point> placements;
         placements.reserve(problem->musicians.size());
 
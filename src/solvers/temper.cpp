@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <oneapi/tbb.h>
+
+#include <core/config.h>
+#include <core/generators.h>
+#include <core/models.h>
+#include <core/moves.h>
+#include <core/program.h>
+#include <core/slot.h>
+#include <core/tasks.h>
+#include <core/timer.h>
+
+// A replica runs at a fixed temperature, its state is exchanged with the replicas at neighbouring temperatures
+struct Replica {
+    double temperature;
+
+    ScoringEngine engine;
+    PlacementGrid grid;
+    MoveSet moves;
+    std::mt19937 rng;
+
+    long long score;
+
+    std::size_t iterations = 0;
+
+    Replica(double temperature, const Solution &solution, unsigned int seed)
+            : temperature(temperature),
+              engine(solution),
+              grid(solution.problem->stage, solution.placements),
+              moves(*solution.problem),
+              rng(seed),
+              score(engine.getScore()) {}
+
+    // Runs Metropolis iterations for the given time or until stop is set, and publishes the best state it passed
+    // through if it improves the best score
+    // The best state is only kept locally while running, so the slot is published to at most once per round
+    void run(double seconds, const std::atomic<bool> &stop, BestSolutionSlot &slot) {
+        std::uniform_real_distribution<double> unitDist(0, 1);
+
+        std::optional<Solution> roundBest;
+        long long roundBestScore = slot.getBestScore();
+
+        Timer timer;
+        while (timer.elapsedSeconds() < seconds && !stop.load(std::memory_order_relaxed)) {
+            for (int batch = 0; batch < 16; batch++) {
+                iterations++;
+
+                auto move = moves.generate(MoveSet::getType(iterations), grid, rng);
+                if (!move) {
+                    continue;
+                }
+
+                long long newScore = tryMove(engine, *move);
+
+                long long delta = newScore - score;
+                if (delta < 0 && unitDist(rng) >= std::exp(static_cast<double>(delta) / temperature)) {
+                    engine.rollback();
+                    continue;
+                }
+
+                commitMove(engine, grid, *move);
+                score = newScore;
+
+                if (score > roundBestScore) {
+                    roundBest = engine.toSolution();
+                    roundBestScore = score;
+                }
+            }
+        }
+
+        if (roundBest) {
+            slot.publish(*roundBest, roundBestScore);
+        }
+    }
+
+    void swapState(Replica &other) {
+        std::swap(engine, other.engine);
+        std::swap(grid, other.grid);
+        std::swap(score, other.score);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    Program program("temper");
+    auto problems = program.parseArgs(argc, argv);
+
+    std::random_device randomDevice;
+    std::mt19937 exchangeRng(randomDevice());
+
+    double temperTime = std::stod(getEnv("TEMPER_TIME", "180"));
+    double exchangeInterval = std::stod(getEnv("TEMPER_EXCHANGE_INTERVAL", "0.5"));
+    double submissionInterval = std::stod(getEnv("TEMPER_SUBMISSION_INTERVAL", "5"));
+
+    // Temperatures default to values calibrated on the score losses of random moves from the initial state
+    std::string maxTemperatureValue = getEnv("TEMPER_MAX_TEMPERATURE", "");
+    std::string minTemperatureValue = getEnv("TEMPER_MIN_TEMPERATURE", "");
+
+    auto replicaCount = static_cast<std::size_t>(std::stoul(getEnv(
+            "TEMPER_REPLICAS", std::to_string(oneapi::tbb::this_task_arena::max_concurrency()))));
+    replicaCount = std::max<std::size_t>(replicaCount, 2);
+
+    for (auto &problemHandle : problems) {
+        auto problem = problemHandle.take();
+
+        Solution initialSolution(problem, {}, {});
+        long long initialScore = 0;
+
+        if (program.isServerEnabled()) {
+            std::cout << *problem << "Retrieving best global solution" << std::endl;
+            auto bestGlobalSolution = program.getBestGlobalSolution(problem);
+            if (bestGlobalSolution) {
+                initialSolution = *bestGlobalSolution;
+                initialScore = bestGlobalSolution->getScore();
+                program.submit(initialSolution, initialScore);
+            } else {
+                std::cout << *problem << "No best global solution found" << std::endl;
+            }
+        }
+
+        if (initialScore == 0) {
+            std::cout << *problem << "Generating initial random solution" << std::endl;
+
+            auto randomSolution = generateRandomSolution(problem);
+            if (!randomSolution) {
+                std::cout << *problem << "Stage can't fit all " << problem->musicians.size() << " musicians"
+                          << std::endl;
+                continue;
+            }
+
+            initialSolution = *randomSolution;
+            initialScore = initialSolution.getScore();
+            program.submit(initialSolution, initialScore);
+        }
+
+        std::vector<Replica> replicas;
+        replicas.reserve(replicaCount);
+        for (std::size_t i = 0; i < replicaCount; i++) {
+            replicas.emplace_back(0, initialSolution, randomDevice());
+        }
+
+        double maxTemperature;
+        if (maxTemperatureValue.empty()) {
+            auto &replica = replicas[0];
+            maxTemperature = sampleMeanLoss(replica.engine, replica.grid, replica.moves, replica.rng, 200);
+        } else {
+            maxTemperature = std::stod(maxTemperatureValue);
+        }
+
+        double minTemperature = minTemperatureValue.empty() ? maxTemperature * 1e-3 : std::stod(minTemperatureValue);
+
+        // Geometric ladder, replicas[0] is the coldest
+        for (std::size_t i = 0; i < replicaCount; i++) {
+            double fraction = static_cast<double>(i) / static_cast<double>(replicaCount - 1);
+            replicas[i].temperature = minTemperature * std::pow(maxTemperature / minTemperature, fraction);
+        }
+
+        std::cout << *problem << "Tempering " << replicaCount << " replicas for " << temperTime
+                  << " seconds with temperatures " << minTemperature << " -> " << maxTemperature
+                  << ", exchanging states every " << exchangeInterval << " seconds" << std::endl;
+
+        BestSolutionSlot slot;
+        slot.publish(initialSolution, initialScore);
+
+        Timer timer;
+        std::atomic<bool> stop{false};
+        std::size_t exchanges = 0;
+
+        // Replicas run on TBB tasks in rounds, between which neighbouring replicas exchange states
+        // The main thread only polls the best solution slot and submits improvements
+        std::thread worker([&] {
+            std::uniform_real_distribution<double> unitDist(0, 1);
+
+            for (std::size_t round = 0; !stop.load(); round++) {
+                double replicaTime = getTaskTime(exchangeInterval, replicas.size());
+
+                runLongTasks(replicas.size(), [&](std::size_t i) {
+                    replicas[i].run(replicaTime, stop, slot);
+                });
+
+                // Alternate between exchanging the (0, 1), (2, 3), ... and the (1, 2), (3, 4), ... pairs
+                for (std::size_t i = round % 2; i + 1 < replicas.size(); i += 2) {
+                    auto &colder = replicas[i];
+                    auto &hotter = replicas[i + 1];
+
+                    double exponent = static_cast<double>(hotter.score - colder.score)
+                                      * (1.0 / colder.temperature - 1.0 / hotter.temperature);
+
+                    if (exponent >= 0 || unitDist(exchangeRng) < std::exp(exponent)) {
+                        colder.swapState(hotter);
+                        exchanges++;
+                    }
+                }
+            }
+        });
+
+        std::uint64_t submittedEpoch = slot.getEpoch();
+        while (timer.elapsedSeconds() < temperTime) {
+            double remaining = temperTime - timer.elapsedSeconds();
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::min(submissionInterval, remaining)));
+
+            // The engines update closeness factors incrementally, so the submitted score is computed from scratch
+            if (auto snapshot = slot.get(submittedEpoch)) {
+                program.submit(snapshot->solution);
+                submittedEpoch = snapshot->epoch;
+            }
+        }
+
+        stop.store(true);
+        worker.join();
+
+        program.submit(slot.get()->solution);
+
+        std::size_t iterations = 0;
+        for (const auto &replica : replicas) {
+            iterations += replica.iterations;
+        }
+
+        std::cout << *problem << "Ran " << iterations << " tempering iterations with "
+                  << exchanges << " replica exchanges" << std::endl;
+    }
+
+    return 0;
+}
@@ -1,13 +1,35 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <random>
+#include <span>
 #include <string>
 #include <vector>
 
+#include <core/assignment.h>
+#include <core/checkpoint.h>
+#include <core/files.h>
+#include <core/generators.h>
+#include <core/gradient.h>
 #include <core/models.h>
+#include <core/slot.h>
+#include <core/submissions.h>
 
 #include <gtest/gtest.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+std::vector<double> toVector(std::span<const double> values) {
+    return {values.begin(), values.end()};
+}
+
 class SolutionFixture : public ::testing::Test {
 protected:
     std::shared_ptr<Problem> createExampleProblem() const {
@@ -36,8 +58,62 @@ protected:
 
         return {problem, placements, volumes};
     }
+
+    Solution createRandomSolution(int id, std::size_t musicianCount, std::size_t attendeeCount) const {
+        std::mt19937 rng(id);
+        std::uniform_real_distribution<double> tasteDist(-1000, 1000);
+        std::uniform_real_distribution<double> xDist(0, 400);
+        std::uniform_real_distribution<double> yDist(400, 600);
+
+        Area room({0, 0}, 400, 600);
+        Area stage({100, 100}, 200, 200);
+
+        std::vector<int> musicians;
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            musicians.emplace_back(static_cast<int>(i % 3));
+        }
+
+        std::vector<Attendee> attendees;
+        for (std::size_t i = 0; i < attendeeCount; i++) {
+            attendees.emplace_back(Point(xDist(rng), yDist(rng)),
+                                   std::vector<double>{tasteDist(rng), tasteDist(rng), tasteDist(rng)});
+        }
+
+        std::vector<Pillar> pillars{
+                {{150, 350}, 5},
+                {{250, 380}, 10}
+        };
+
+        auto problem = std::make_shared<Problem>(id, room, stage, musicians, attendees, pillars);
+
+        std::vector<Point> placements;
+        for (std::size_t i = 0; i < musicianCount; i++) {
+            placements.emplace_back(110 + 15 * static_cast<double>(i % 12), 110 + 15 * static_cast<double>(i / 12));
+        }
+
+        return {problem, placements};
+    }
 };
 
+TEST_F(SolutionFixture, FlatAttendeeData) {
+    auto problem = createExampleProblem();
+
+    EXPECT_EQ(problem->instrumentCount, 2);
+    EXPECT_EQ(toVector(problem->attendeeXs), std::vector<double>({100, 200, 1100}));
+    EXPECT_EQ(toVector(problem->attendeeYs), std::vector<double>({500, 1000, 800}));
+    EXPECT_EQ(toVector(problem->tasteMatrix), std::vector<double>({1000, -1000, 200, 200, 800, 1500}));
+    EXPECT_EQ(toVector(problem->instrumentTastes), std::vector<double>({1000, 200, 800, -1000, 200, 1500}));
+
+    EXPECT_EQ(problem->getMusicianTastes(1)[0], -1000);
+    EXPECT_EQ(problem->getMusicianTastes(2)[2], 800);
+    EXPECT_EQ(problem->getAttendeeTastes(2)[1], 1500);
+
+    // The tastes only live on in the matrices
+    for (const auto &attendee : problem->attendees) {
+        EXPECT_EQ(attendee.tastes.capacity(), 0);
+    }
+}
+
 TEST_F(SolutionFixture, IsValidExample) {
     auto solution = createExampleSolution();
 
@@ -94,6 +170,16 @@ TEST_F(SolutionFixture, GetScoreExampleFull) {
     EXPECT_EQ(solution.getScore(ScoreType::FULL, false), 5357);
 }
 
+TEST_F(SolutionFixture, GetScoreOptimizesVolumes) {
+    auto solution = createExampleSolution();
+
+    EXPECT_EQ(solution.getScore(ScoreType::LIGHTNING, true), 60810);
+    EXPECT_EQ(solution.volumes, std::vector<double>({10, 0, 10}));
+
+    EXPECT_EQ(solution.getScore(ScoreType::FULL, true), 60928);
+    EXPECT_EQ(solution.volumes, std::vector<double>({10, 0, 10}));
+}
+
 TEST_F(SolutionFixture, GetScoreExtendedExample) {
     int id = 1;
     Area room({0, 0}, 2000, 5000);
@@ -135,6 +221,654 @@ TEST_F(SolutionFixture, ToJsonExample) {
               "{\"placements\":[{\"x\":590.0,\"y\":10.0},{\"x\":1100.0,\"y\":100.0},{\"x\":1100.0,\"y\":150.0}],\"volumes\":[1.0,1.0,1.0]}");
 }
 
+TEST_F(SolutionFixture, AppendJsonMatchesToJson) {
+    auto solution = createExampleSolution();
+
+    rapidjson::StringBuffer jsonBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonBuffer);
+    solution.toJson().Accept(jsonWriter);
+
+    std::string json;
+    solution.appendJson(json);
+    EXPECT_EQ(json, jsonBuffer.GetString());
+
+    auto randomSolution = createRandomSolution(111, 20, 10);
+    randomSolution.volumes[3] = 0.1;
+
+    json.clear();
+    randomSolution.appendJson(json);
+
+    rapidjson::Document document;
+    document.Parse(json.c_str());
+    ASSERT_FALSE(document.HasParseError());
+
+    // rapidjson doesn't parse with full precision by default, so the values may be off in the last digit
+    Solution parsedSolution(randomSolution.problem, document);
+    ASSERT_EQ(parsedSolution.placements.size(), randomSolution.placements.size());
+    for (std::size_t i = 0; i < randomSolution.placements.size(); i++) {
+        EXPECT_DOUBLE_EQ(parsedSolution.placements[i].x, randomSolution.placements[i].x);
+        EXPECT_DOUBLE_EQ(parsedSolution.placements[i].y, randomSolution.placements[i].y);
+    }
+
+    ASSERT_EQ(parsedSolution.volumes.size(), randomSolution.volumes.size());
+    for (std::size_t i = 0; i < randomSolution.volumes.size(); i++) {
+        EXPECT_DOUBLE_EQ(parsedSolution.volumes[i], randomSolution.volumes[i]);
+    }
+}
+
+TEST_F(SolutionFixture, ScoringEngineMatchesGetScore) {
+    auto solution = createRandomSolution(100, 30, 40);
+    ScoringEngine engine(solution);
+
+    EXPECT_EQ(engine.getScore(), solution.getScore());
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<std::size_t> indexDist(0, solution.placements.size() - 1);
+    std::uniform_real_distribution<double> deltaDist(-5.0, 5.0);
+
+    for (int iteration = 0; iteration < 50; iteration++) {
+        std::size_t musician = indexDist(rng);
+
+        Solution newSolution(solution);
+        newSolution.placements[musician].x += deltaDist(rng);
+        newSolution.placements[musician].y += deltaDist(rng);
+
+        if (!newSolution.isValid()) {
+            continue;
+        }
+
+        auto newScore = engine.tryMove(musician, newSolution.placements[musician]);
+        EXPECT_EQ(newScore, newSolution.getScore());
+
+        if (iteration % 2 == 0) {
+            engine.commit();
+            solution = newSolution;
+        } else {
+            engine.rollback();
+        }
+
+        EXPECT_EQ(engine.getScore(), solution.getScore());
+    }
+
+    EXPECT_EQ(engine.toSolution().placements.size(), solution.placements.size());
+    EXPECT_EQ(ScoringEngine(engine.toSolution()).getScore(), engine.getScore());
+}
+
+// Closeness factors are updated incrementally between resyncs, so this commits enough moves for several resyncs
+TEST_F(SolutionFixture, ScoringEngineMatchesGetScoreAfterResyncs) {
+    auto solution = createRandomSolution(112, 12, 20);
+    ScoringEngine engine(solution);
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<std::size_t> indexDist(0, solution.placements.size() - 1);
+    std::uniform_real_distribution<double> deltaDist(-5.0, 5.0);
+
+    int commits = 0;
+    while (commits < 5000) {
+        std::size_t musician = indexDist(rng);
+
+        Point placement = solution.placements[musician];
+        placement.x += deltaDist(rng);
+        placement.y += deltaDist(rng);
+
+        Solution newSolution(solution);
+        newSolution.placements[musician] = placement;
+        if (!newSolution.isValid()) {
+            continue;
+        }
+
+        engine.tryMove(musician, placement);
+        engine.commit();
+        solution = newSolution;
+        commits++;
+
+        if (commits % 500 == 0) {
+            EXPECT_EQ(engine.getScore(), engine.toSolution().getScore());
+        }
+    }
+
+    EXPECT_EQ(engine.getScore(), engine.toSolution().getScore());
+}
+
+TEST_F(SolutionFixture, ScoringEngineSwapMatchesGetScore) {
+    auto solution = createRandomSolution(101, 30, 40);
+    ScoringEngine engine(solution);
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<std::size_t> indexDist(0, solution.placements.size() - 1);
+
+    for (int iteration = 0; iteration < 50; iteration++) {
+        std::size_t musician1 = indexDist(rng);
+        std::size_t musician2 = indexDist(rng);
+
+        Solution newSolution(solution);
+        std::swap(newSolution.placements[musician1], newSolution.placements[musician2]);
+
+        auto newScore = engine.trySwap(musician1, musician2);
+        EXPECT_EQ(newScore, newSolution.getScore());
+
+        if (iteration % 2 == 0) {
+            engine.commit();
+            solution = newSolution;
+        } else {
+            engine.rollback();
+        }
+
+        EXPECT_EQ(engine.getScore(), solution.getScore());
+    }
+
+    auto placement = engine.getPlacements()[0];
+    placement.x += 1;
+    EXPECT_EQ(engine.tryMove(0, placement), ScoringEngine(engine.toSolution()).tryMove(0, placement));
+}
+
+TEST_F(SolutionFixture, TiledGetScoreMatchesScoringEngine) {
+    auto tiling = getScoreTiling(3, 200, 4);
+    EXPECT_EQ(tiling.attendeeGrain, 1);
+    EXPECT_LT(tiling.musicianGrain, 200);
+    EXPECT_GE(tiling.musicianGrain, 64);
+
+    EXPECT_EQ(getScoreTiling(1000, 200, 4).musicianGrain, 200);
+
+    // Few attendees and many musicians, so that getScore() splits musicians over multiple tiles
+    auto solution = createRandomSolution(103, 200, 3);
+    for (auto type : {ScoreType::LIGHTNING, ScoreType::FULL}) {
+        EXPECT_EQ(solution.getScore(type), ScoringEngine(solution, type).getScore());
+
+        // Scoring with the volumes just optimized by getScore() must give the same result
+        EXPECT_EQ(solution.getScore(type, false), ScoringEngine(solution, type).getScore());
+    }
+}
+
+TEST_F(SolutionFixture, ClosenessCacheMatchesRecomputation) {
+    auto solution = createRandomSolution(102, 30, 10);
+    ClosenessCache cache(solution.problem->musicians, solution.placements);
+
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<std::size_t> indexDist(0, solution.placements.size() - 1);
+    std::uniform_real_distribution<double> offsetDist(-2, 2);
+
+    // Enough updates to trigger group resyncs
+    for (int iteration = 0; iteration < 3000; iteration++) {
+        std::size_t musician1 = indexDist(rng);
+        std::size_t musician2 = indexDist(rng);
+
+        if (iteration % 3 == 0) {
+            cache.swap(musician1, musician2);
+            std::swap(solution.placements[musician1], solution.placements[musician2]);
+        } else {
+            Point placement = solution.placements[musician1];
+            placement.x += offsetDist(rng);
+            placement.y += offsetDist(rng);
+
+            cache.move(musician1, placement);
+            solution.placements[musician1] = placement;
+        }
+    }
+
+    ClosenessCache expected(solution.problem->musicians, solution.placements);
+    for (std::size_t i = 0; i < solution.placements.size(); i++) {
+        EXPECT_NEAR(cache.getFactors()[i], expected.getFactors()[i], 1e-9);
+    }
+}
+
+TEST_F(SolutionFixture, ScoreGradientMatchesFiniteDifferences) {
+    auto solution = createRandomSolution(112, 20, 10);
+    const auto &problem = solution.problem;
+    std::size_t attendeeCount = problem->attendees.size();
+
+    for (std::size_t i = 0; i < solution.volumes.size(); i++) {
+        solution.volumes[i] = static_cast<double>(i % 4) * 2.5;
+    }
+
+    for (auto type : {ScoreType::LIGHTNING, ScoreType::FULL}) {
+        // The relaxed score keeps visibility fixed, so it is recomputed here with that of the unmoved placements
+        auto visible = getVisibility(solution, type);
+        auto getRelaxedScore = [&](const std::vector<Point> &placements) {
+            ClosenessCache closeness(problem->musicians, placements);
+
+            double score = 0;
+            for (std::size_t i = 0; i < placements.size(); i++) {
+                double closenessFactor = type == ScoreType::FULL ? closeness.getFactors()[i] : 1;
+                for (std::size_t attendeeIdx = 0; attendeeIdx < attendeeCount; attendeeIdx++) {
+                    if (visible[i * attendeeCount + attendeeIdx]) {
+                        double dx = placements[i].x - problem->attendeeXs[attendeeIdx];
+                        double dy = placements[i].y - problem->attendeeYs[attendeeIdx];
+                        double impact = 1'000'000.0 * problem->getMusicianTastes(i)[attendeeIdx] / (dx * dx + dy * dy);
+                        score += solution.volumes[i] * closenessFactor * impact;
+                    }
+                }
+            }
+
+            return score;
+        };
+
+        auto gradient = getScoreGradient(solution, type);
+
+        constexpr double step = 1e-4;
+        for (std::size_t i = 0; i < solution.placements.size(); i++) {
+            auto placements = solution.placements;
+
+            placements[i].x = solution.placements[i].x + step;
+            double right = getRelaxedScore(placements);
+            placements[i].x = solution.placements[i].x - step;
+            double left = getRelaxedScore(placements);
+            placements[i].x = solution.placements[i].x;
+
+            placements[i].y = solution.placements[i].y + step;
+            double up = getRelaxedScore(placements);
+            placements[i].y = solution.placements[i].y - step;
+            double down = getRelaxedScore(placements);
+
+            double expectedX = (right - left) / (2 * step);
+            double expectedY = (up - down) / (2 * step);
+            EXPECT_NEAR(gradient[i].x, expectedX, 1e-3 + 1e-5 * std::abs(expectedX));
+            EXPECT_NEAR(gradient[i].y, expectedY, 1e-3 + 1e-5 * std::abs(expectedY));
+        }
+    }
+}
+
+TEST(PlacementGridTest, MatchesPairwiseCheck) {
+    Area stage({0, 0}, 100, 60);
+
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<double> xDist(-5, 105);
+    std::uniform_real_distribution<double> yDist(-5, 65);
+
+    PlacementGrid grid(stage);
+    std::vector<Point> placements;
+    while (placements.size() < 30) {
+        Point point(xDist(rng), yDist(rng));
+        if (grid.canAdd(point)) {
+            grid.add(point);
+            placements.emplace_back(point);
+        }
+    }
+
+    EXPECT_TRUE(grid.isValid());
+
+    std::uniform_int_distribution<std::size_t> indexDist(0, placements.size() - 1);
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        std::size_t index = indexDist(rng);
+        Point point(xDist(rng), yDist(rng));
+
+        bool expected = stage.isInside(point);
+        for (std::size_t i = 0; i < placements.size(); i++) {
+            if (i != index && placements[i].distanceTo2(point) < 100) {
+                expected = false;
+            }
+        }
+
+        EXPECT_EQ(grid.canMove(index, point), expected);
+
+        auto moved = placements;
+        moved[index] = point;
+        EXPECT_EQ(arePlacementsValid(stage, moved), expected);
+
+        if (expected) {
+            grid.move(index, point);
+            placements[index] = point;
+        }
+    }
+
+    EXPECT_TRUE(PlacementGrid(stage, placements).isValid());
+    EXPECT_TRUE(arePlacementsValid(stage, placements));
+
+    placements.emplace_back(placements[0].x + 3, placements[0].y);
+    EXPECT_FALSE(PlacementGrid(stage, placements).isValid());
+    EXPECT_FALSE(arePlacementsValid(stage, placements));
+}
+
+TEST(VisibilitySweepTest, MatchesBlockerScan) {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> coordinateDist(0, 100);
+
+    std::vector<Point> placements;
+    while (placements.size() < 60) {
+        Point point(coordinateDist(rng), coordinateDist(rng));
+        if (std::all_of(placements.begin(), placements.end(), [&](const Point &placement) {
+            return placement.distanceTo2(point) >= 100;
+        })) {
+            placements.emplace_back(point);
+        }
+    }
+
+    std::vector<Pillar> pillars{
+            {{-20, 50},  8},
+            {{50,  130}, 15},
+            {{140, 40},  3}
+    };
+
+    // Attendees all around the musicians, so the angular windows also wrap around -pi/pi
+    std::vector<Point> attendees{{-50, 50}, {-30, 48}, {50, 200}, {180, 20}, {50, -60}, {-5, -5}, {105, 105}};
+
+    VisibilitySweep sweep;
+    for (const auto &attendee : attendees) {
+        sweep.reset(attendee, placements, &pillars);
+
+        for (std::size_t i = 0; i < placements.size(); i++) {
+            int count = 0;
+            for (std::size_t j = 0; j < placements.size(); j++) {
+                if (i != j && isBlocking(placements[i], attendee, placements[j], 5)) {
+                    count++;
+                }
+            }
+
+            bool pillarBlocked = std::any_of(pillars.begin(), pillars.end(), [&](const Pillar &pillar) {
+                return isBlocking(placements[i], attendee, pillar.center, pillar.radius);
+            });
+
+            EXPECT_EQ(sweep.countBlockers(i), count);
+            EXPECT_EQ(sweep.isBlocked(i), count > 0 || pillarBlocked);
+        }
+    }
+}
+
+TEST(PillarOcclusionTest, MatchesPillarScan) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> coordinateDist(-100, 100);
+    std::uniform_real_distribution<double> radiusDist(1, 20);
+
+    std::vector<Pillar> pillars;
+    for (int i = 0; i < 25; i++) {
+        pillars.emplace_back(Point(coordinateDist(rng), coordinateDist(rng)), radiusDist(rng));
+    }
+
+    // Includes an origin inside a pillar and origins whose intervals wrap around -pi/pi
+    std::vector<Point> origins{{0, 0}, pillars[0].center, {-150, 0}, {150, 3}, {0, 150}};
+
+    for (const auto &origin : origins) {
+        PillarOcclusion occlusion(origin, pillars);
+
+        for (int i = 0; i < 2000; i++) {
+            Point point(coordinateDist(rng), coordinateDist(rng));
+
+            bool expected = std::any_of(pillars.begin(), pillars.end(), [&](const Pillar &pillar) {
+                return isBlocking(point, origin, pillar.center, pillar.radius);
+            });
+
+            EXPECT_EQ(occlusion.isBlocked(point, pillars), expected);
+        }
+    }
+}
+
+TEST_F(SolutionFixture, BestSolutionSlotKeepsBestScore) {
+    auto solution = createRandomSolution(104, 5, 5);
+
+    BestSolutionSlot slot;
+    EXPECT_FALSE(slot.get().has_value());
+    EXPECT_EQ(slot.getEpoch(), 0);
+
+    // Readers copy snapshots while they are replaced and freed, each copy has to be one of the published ones
+    std::atomic<int> inconsistent{0};
+    oneapi::tbb::parallel_for(0, 1000, [&](int i) {
+        slot.publish(solution, (i * 7919) % 1000);
+
+        auto snapshot = slot.get();
+        if (!snapshot || snapshot->score < 0 || snapshot->score >= 1000 || snapshot->epoch == 0
+            || snapshot->solution.placements.size() != solution.placements.size()) {
+            inconsistent++;
+        }
+    });
+
+    EXPECT_EQ(inconsistent.load(), 0);
+    EXPECT_EQ(slot.get()->score, 999);
+    EXPECT_EQ(slot.getBestScore(), 999);
+
+    // Snapshots are only copied if they changed since the given epoch
+    auto epoch = slot.getEpoch();
+    EXPECT_GE(epoch, 1);
+    EXPECT_FALSE(slot.get(epoch).has_value());
+
+    EXPECT_EQ(slot.publish(solution, 999), 0);
+    EXPECT_EQ(slot.publish(solution, 1000), epoch + 1);
+    EXPECT_EQ(slot.getBestScore(), 1000);
+    EXPECT_EQ(slot.get(epoch)->score, 1000);
+}
+
+TEST_F(SolutionFixture, GenerateRandomSolutionFillsStage) {
+    std::mt19937 rng(105);
+
+    // The 200x200 stage holds far more musicians than fit on its edges, but not 1000
+    for (std::size_t musicianCount : {10, 300}) {
+        auto problem = createRandomSolution(105, musicianCount, 5).problem;
+        auto solution = generateRandomSolution(problem, rng);
+
+        ASSERT_TRUE(solution.has_value());
+        EXPECT_TRUE(solution->isValid());
+    }
+
+    auto problem = createRandomSolution(105, 1000, 5).problem;
+    EXPECT_FALSE(generateRandomSolution(problem, rng).has_value());
+}
+
+TEST(CheckpointTest, RoundTripsState) {
+    auto path = std::filesystem::temp_directory_path() / "icfpc-checkpoint-test" / "state.bin";
+
+    std::mt19937 rng(106);
+    rng.discard(1000);
+
+    CheckpointWriter writer;
+    writer.write(42);
+    writer.write(std::vector<Point>{{1, 2}, {3, 4}});
+    writer.write(std::string("brute"));
+    writer.writeRng(rng);
+    ASSERT_TRUE(writer.save(path));
+
+    auto reader = CheckpointReader::load(path);
+    ASSERT_TRUE(reader.has_value());
+
+    EXPECT_EQ(reader->read<int>(), 42);
+
+    auto points = reader->readVector<Point>();
+    ASSERT_EQ(points.size(), 2);
+    EXPECT_EQ(points[1].x, 3);
+    EXPECT_EQ(points[1].y, 4);
+
+    EXPECT_EQ(reader->readString(), "brute");
+
+    std::mt19937 restoredRng;
+    reader->readRng(restoredRng);
+    EXPECT_EQ(restoredRng(), rng());
+
+    EXPECT_TRUE(reader->isValid());
+    reader->read<long long>();
+    EXPECT_FALSE(reader->isValid());
+
+    std::filesystem::remove_all(path.parent_path());
+}
+
+TEST(FilesTest, ConcurrentAtomicWritesLeaveOneCompleteFile) {
+    auto directory = std::filesystem::temp_directory_path() / "icfpc-files-test";
+    std::filesystem::remove_all(directory);
+
+    oneapi::tbb::parallel_for(0, 16, [&](int i) {
+        EXPECT_TRUE(writeFileAtomically(directory / "data.txt", std::string(1000, static_cast<char>('a' + i))));
+    });
+
+    std::ifstream inputStream(directory / "data.txt", std::ios::binary);
+    std::string contents(std::istreambuf_iterator<char>(inputStream), {});
+
+    ASSERT_EQ(contents.size(), 1000);
+    EXPECT_EQ(std::count(contents.begin(), contents.end(), contents[0]), 1000);
+
+    // No temporary files are left behind
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), {}), 1);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_F(SolutionFixture, BinaryProblemMatchesJsonProblem) {
+    auto solution = createRandomSolution(107, 20, 30);
+    auto path = std::filesystem::temp_directory_path() / "icfpc-binary-problem-test.bin";
+
+    ASSERT_TRUE(solution.problem->writeBinary(path));
+
+    auto problem = Problem::loadBinary(path);
+    ASSERT_NE(problem, nullptr);
+
+    EXPECT_EQ(problem->id, solution.problem->id);
+    EXPECT_EQ(problem->stage.bottomLeft.x, solution.problem->stage.bottomLeft.x);
+    EXPECT_EQ(problem->stage.width, solution.problem->stage.width);
+    EXPECT_EQ(problem->musicians, solution.problem->musicians);
+    EXPECT_EQ(problem->attendees.size(), solution.problem->attendees.size());
+    EXPECT_EQ(problem->pillars.size(), solution.problem->pillars.size());
+    EXPECT_EQ(toVector(problem->tasteMatrix), toVector(solution.problem->tasteMatrix));
+    EXPECT_EQ(toVector(problem->instrumentTastes), toVector(solution.problem->instrumentTastes));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(problem->tasteMatrix.data()) % BINARY_PROBLEM_ALIGNMENT, 0);
+
+    Solution binarySolution(problem, solution.placements, solution.volumes);
+    EXPECT_EQ(binarySolution.getScore(), solution.getScore());
+
+    std::filesystem::remove(path);
+}
+
+TEST_F(SolutionFixture, SubmissionQueueCoalescesPerProblem) {
+    auto first = createRandomSolution(108, 5, 10);
+    auto second = createRandomSolution(109, 5, 10);
+
+    SubmissionQueue queue(2);
+    EXPECT_TRUE(queue.push({first, 10, true, false}));
+    EXPECT_TRUE(queue.push({second, 20, false, true}));
+    EXPECT_TRUE(queue.push({first, 30, false, true}));
+    EXPECT_TRUE(queue.push({first, 5, false, true}));
+    EXPECT_FALSE(queue.push({createRandomSolution(110, 5, 10), 40, true, true}));
+    EXPECT_EQ(queue.size(), 2);
+
+    auto submission = queue.pop();
+    ASSERT_TRUE(submission.has_value());
+    EXPECT_EQ(submission->solution.problem->id, 108);
+    EXPECT_EQ(submission->score, 30);
+    EXPECT_TRUE(submission->writeLocal);
+    EXPECT_TRUE(submission->submitGlobal);
+
+    submission->attempts++;
+    EXPECT_TRUE(queue.retry(*submission, std::chrono::hours(1)));
+
+    // The problem waiting for a retry doesn't hold up the others
+    submission = queue.pop();
+    ASSERT_TRUE(submission.has_value());
+    EXPECT_EQ(submission->solution.problem->id, 109);
+
+    queue.close();
+    EXPECT_FALSE(queue.push({second, 50, true, true}));
+
+    submission = queue.pop();
+    ASSERT_TRUE(submission.has_value());
+    EXPECT_EQ(submission->solution.problem->id, 108);
+    EXPECT_EQ(submission->attempts, 1);
+    EXPECT_FALSE(queue.retry(*submission, std::chrono::seconds(1)));
+
+    EXPECT_FALSE(queue.pop().has_value());
+}
+
+TEST(AssignmentTest, FindsMinimumCostAssignment) {
+    std::mt19937 rng(6);
+    std::uniform_int_distribution<int> costDist(-50, 50);
+
+    std::size_t rows = 4;
+    std::size_t columns = 6;
+
+    std::vector<double> costs;
+    for (std::size_t i = 0; i < rows * columns; i++) {
+        costs.emplace_back(costDist(rng));
+    }
+
+    auto getCost = [&](const std::vector<std::size_t> &assignment) {
+        double cost = 0;
+        for (std::size_t row = 0; row < rows; row++) {
+            cost += costs[row * columns + assignment[row]];
+        }
+
+        return cost;
+    };
+
+    // Brute force over all injective assignments, as permutations of the columns
+    std::vector<std::size_t> permutation(columns);
+    for (std::size_t i = 0; i < columns; i++) {
+        permutation[i] = i;
+    }
+
+    double expectedCost = std::numeric_limits<double>::infinity();
+    do {
+        expectedCost = std::min(expectedCost, getCost(permutation));
+    } while (std::next_permutation(permutation.begin(), permutation.end()));
+
+    auto assignment = solveAssignment(costs, rows, columns);
+
+    std::vector<std::size_t> usedColumns(assignment);
+    std::sort(usedColumns.begin(), usedColumns.end());
+
+    EXPECT_EQ(std::adjacent_find(usedColumns.begin(), usedColumns.end()), usedColumns.end());
+    EXPECT_EQ(getCost(assignment), expectedCost);
+}
+
+TEST(BlockingTest, CountBlockingMatchesIsBlocking) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> coordinateDist(0, 100);
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    for (int i = 0; i < 37; i++) {
+        xs.emplace_back(coordinateDist(rng));
+        ys.emplace_back(coordinateDist(rng));
+    }
+
+    for (int line = 0; line < 50; line++) {
+        double fromX = coordinateDist(rng);
+        double fromY = coordinateDist(rng);
+        double toX = coordinateDist(rng);
+        double toY = coordinateDist(rng);
+
+        for (std::size_t begin : {0, 3}) {
+            for (std::size_t end : {0, 5, 16, 37}) {
+                std::size_t skip = (begin + end) / 2;
+
+                std::size_t expected = 0;
+                for (std::size_t i = begin; i < end; i++) {
+                    if (i != skip && isBlocking(fromX, fromY, toX, toY, xs[i], ys[i], 5)) {
+                        expected++;
+                    }
+                }
+
+                EXPECT_EQ(countBlocking(fromX, fromY, toX, toY, xs.data(), ys.data(), begin, end, skip, 5), expected);
+                EXPECT_EQ(countBlocking(fromX, fromY, toX, toY, xs.data(), ys.data(), begin, end, skip, 5, true),
+                          expected > 0 ? 1 : 0);
+            }
+        }
+    }
+
+    // Lines through the tangent points of a circle are blocked or not within rounding error, and every lane of a batch
+    // and a single circle must still agree on them
+    for (int tangent = 0; tangent < 200; tangent++) {
+        double angle = coordinateDist(rng);
+        double fromX = 50 + 5 * std::cos(angle) - 60 * std::sin(angle);
+        double fromY = 50 + 5 * std::sin(angle) + 60 * std::cos(angle);
+        double toX = 50 + 5 * std::cos(angle) + 60 * std::sin(angle);
+        double toY = 50 + 5 * std::sin(angle) - 60 * std::cos(angle);
+
+        std::vector<double> circleXs(13, 50);
+        std::vector<double> circleYs(13, 50);
+        std::size_t expected = isBlocking(fromX, fromY, toX, toY, 50, 50, 5) ? 10 : 0;
+
+        for (std::size_t begin = 0; begin < 4; begin++) {
+            EXPECT_EQ(countBlocking(fromX, fromY, toX, toY, circleXs.data(), circleYs.data(), begin, begin + 10,
+                                    begin + 10, 5), expected);
+        }
+
+        // Moving the circle off the line and back must change the count by exactly what isBlocking() says
+        std::vector<double> toXs(11, toX);
+        std::vector<double> toYs(11, toY);
+        std::vector<int> deltas(11);
+
+        getBlockingDeltas(fromX, fromY, toXs.data(), toYs.data(), 11, 1000, 1000, 50, 50, 5, deltas.data());
+        EXPECT_EQ(std::count(deltas.begin(), deltas.end(), expected > 0 ? 1 : 0), 11);
+
+        getBlockingDeltas(fromX, fromY, toXs.data(), toYs.data(), 11, 50, 50, 1000, 1000, 5, deltas.data());
+        EXPECT_EQ(std::count(deltas.begin(), deltas.end(), expected > 0 ? -1 : 0), 11);
+    }
+}
+
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();